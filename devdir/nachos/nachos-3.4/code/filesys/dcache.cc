@@ -0,0 +1,193 @@
+// dcache.cc
+//	Routines to manage the directory entry cache.
+//
+//	The cache is a fixed pool of entries, each on one hash chain and
+//	on a doubly linked LRU list.  A miss reuses the least recently
+//	used entry; unused entries start at the tail, so they go first.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "dcache.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// DentryCache::DentryCache
+// 	Initialize an empty cache of "size" entries.
+//----------------------------------------------------------------------
+
+DentryCache::DentryCache(int size)
+{
+    ASSERT(size > 0);
+    numEntries = size;
+    entries = new Dentry[size];
+    hashTable = new Dentry *[size];
+    for (int i = 0; i < size; i++) {
+	entries[i].dir = -1;
+	entries[i].hashNext = NULL;
+	entries[i].lruPrev = (i > 0) ? &entries[i - 1] : NULL;
+	entries[i].lruNext = (i < size - 1) ? &entries[i + 1] : NULL;
+	hashTable[i] = NULL;
+    }
+    mostRecent = &entries[0];
+    leastRecent = &entries[size - 1];
+    lock = new Lock("dentry cache");
+}
+
+DentryCache::~DentryCache()
+{
+    delete [] entries;
+    delete [] hashTable;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Hash
+// 	Pick the bucket for a name in directory "dir".
+//----------------------------------------------------------------------
+
+int
+DentryCache::Hash(int dir, char *name)
+{
+    unsigned int hash = dir;
+
+    while (*name != '\0')
+	hash = hash * 33 + (unsigned char) *name++;
+    return hash % numEntries;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Find
+// 	Return the entry for "name" in "dir", or NULL if there is none.
+//	Called with the lock held.
+//----------------------------------------------------------------------
+
+Dentry *
+DentryCache::Find(int dir, char *name)
+{
+    Dentry *d;
+
+    for (d = hashTable[Hash(dir, name)]; d != NULL; d = d->hashNext)
+	if (d->dir == dir && !strncmp(d->name, name, FileNameMaxLen))
+	    break;
+    return d;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Lookup
+// 	If we know where "name" in directory "dir" is, store its header
+//	sector in "*sector" (-1 if we know it doesn't exist), and whether
+//	it is a directory in "*isDir", and return TRUE.  Return FALSE if
+//	the directory has to be read.
+//----------------------------------------------------------------------
+
+bool
+DentryCache::Lookup(int dir, char *name, int *sector, bool *isDir)
+{
+    Dentry *d;
+
+    lock->Acquire();
+    d = Find(dir, name);
+    if (d != NULL) {
+	stats->numDentryHits++;
+	*sector = d->sector;
+	*isDir = d->isDir;
+	MakeMostRecent(d);
+    } else
+	stats->numDentryMisses++;
+    lock->Release();
+    return d != NULL;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Enter
+// 	Remember that "name" in directory "dir" has its header at
+//	"sector" (or, if "sector" is -1, that there is no such name).
+//	Names too long to be in a directory aren't remembered.
+//----------------------------------------------------------------------
+
+void
+DentryCache::Enter(int dir, char *name, int sector, bool isDir)
+{
+    Dentry *d;
+
+    if (strlen(name) > FileNameMaxLen)
+	return;
+    lock->Acquire();
+    d = Find(dir, name);
+    if (d == NULL) {				// take the oldest
+	int b = Hash(dir, name);
+
+	d = leastRecent;
+	Unhash(d);
+	d->dir = dir;
+	strncpy(d->name, name, FileNameMaxLen);
+	d->name[FileNameMaxLen] = '\0';
+	d->hashNext = hashTable[b];
+	hashTable[b] = d;
+    }
+    d->sector = sector;
+    d->isDir = isDir;
+    MakeMostRecent(d);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Invalidate
+// 	Forget every name in directory "dir", and every name that leads
+//	to it (such as ".." in a subdirectory), because the file is gone
+//	and its sector may be reused.
+//----------------------------------------------------------------------
+
+void
+DentryCache::Invalidate(int dir)
+{
+    lock->Acquire();
+    for (int i = 0; i < numEntries; i++)
+	if (entries[i].dir == dir
+		|| (entries[i].dir != -1 && entries[i].sector == dir)) {
+	    Unhash(&entries[i]);
+	    entries[i].dir = -1;
+	}
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Unhash
+// 	Take "d" out of its hash bucket, if it is in one.
+//----------------------------------------------------------------------
+
+void
+DentryCache::Unhash(Dentry *d)
+{
+    if (d->dir == -1)
+	return;
+    Dentry **ptr = &hashTable[Hash(d->dir, d->name)];
+    while (*ptr != d)
+	ptr = &(*ptr)->hashNext;
+    *ptr = d->hashNext;
+    d->hashNext = NULL;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::MakeMostRecent
+// 	Move "d" to the front of the LRU list.
+//----------------------------------------------------------------------
+
+void
+DentryCache::MakeMostRecent(Dentry *d)
+{
+    if (d == mostRecent)
+	return;
+    d->lruPrev->lruNext = d->lruNext;	// not first, so has a prev
+    if (d->lruNext != NULL)
+	d->lruNext->lruPrev = d->lruPrev;
+    else
+	leastRecent = d->lruPrev;
+    d->lruPrev = NULL;
+    d->lruNext = mostRecent;
+    mostRecent->lruPrev = d;
+    mostRecent = d;
+}
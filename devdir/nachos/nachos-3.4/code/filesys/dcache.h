@@ -0,0 +1,77 @@
+// dcache.h
+//	Data structures for the directory entry cache.
+//
+//	Looking up a name means reading the directory it is in; a path
+//	means reading one directory per component.  The dentry cache
+//	remembers the answers: it maps (directory header sector, name)
+//	to the header sector of the named file, so that opening a file
+//	again doesn't read any directory at all.  It also remembers
+//	names that were looked for and not found ("negative" entries),
+//	since a failed lookup costs as much as a successful one.
+//
+//	The file system keeps the cache in step with the directories:
+//	Create and Remove update the entry for the name they change, and
+//	removing a file forgets every entry inside it or leading to it.  Entries are
+//	keyed by directory sector, not by path, so changing the current
+//	directory invalidates nothing.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef DCACHE_H
+#define DCACHE_H
+
+#include "copyright.h"
+#include "directory.h"
+#include "synch.h"
+
+#define DentryCacheSize		64	// names remembered at once
+
+// One remembered name.
+
+class Dentry {
+  public:
+    int dir;				// header sector of the directory,
+					// -1 if the entry is unused
+    char name[FileNameMaxLen + 1];	// name looked up in it
+    int sector;				// its header sector, -1 if the
+					// name isn't there
+    bool isDir;				// is it a directory?
+    Dentry *hashNext;			// next entry in the same bucket
+    Dentry *lruPrev, *lruNext;		// neighbours, most recently used first
+};
+
+// The cache: a fixed number of entries, found through a hash table,
+// and reused least recently used first.
+
+class DentryCache {
+  public:
+    DentryCache(int size);		// Initialize an empty cache
+    ~DentryCache();
+
+    bool Lookup(int dir, char *name, int *sector, bool *isDir);
+					// If the answer is known, return
+					// TRUE and put it in "*sector"
+					// (-1 if there is no such file)
+    void Enter(int dir, char *name, int sector, bool isDir);
+					// Remember an answer
+    void Invalidate(int dir);		// Forget every name in "dir",
+					// and every name for it
+
+  private:
+    Dentry *Find(int dir, char *name);	// Entry for a name, or NULL
+    void Unhash(Dentry *d);		// Take it out of its bucket
+    void MakeMostRecent(Dentry *d);	// Move it to the front of the LRU list
+    int Hash(int dir, char *name);
+
+    Dentry *entries;			// all the entries
+    int numEntries;
+    Dentry **hashTable;			// entries by Hash(dir, name)
+    Dentry *mostRecent, *leastRecent;	// ends of the LRU list
+    Lock *lock;				// lookups are made under the
+					// directory lock held for reading,
+					// so several may run at once
+};
+
+#endif // DCACHE_H
@@ -1,21 +1,24 @@
 // directory.cc 
 //	Routines to manage a directory of file names.
 //
-//	The directory is a table of fixed length entries; each
+//	The directory is a hash table of fixed length entries; each
 //	entry represents a single file, and contains the file name,
 //	and the location of the file header on disk.  The fixed size
 //	of each directory entry means that we have the restriction
 //	of a fixed maximum size for file names.
 //
+//	On disk, the directory file starts with a DirectoryHeader
+//	sector, followed by "numBuckets" sectors of entries.  A name is
+//	looked for in the bucket its hash picks, then (if that bucket is
+//	full) in the following ones, until a bucket with a free entry
+//	turns up.  Since the table is kept at most 3/4 full, that is
+//	usually the first bucket: one sector read per lookup.  When it
+//	would get fuller, the table is doubled and every name rehashed.
+//
 //	The constructor initializes an empty directory of a certain size;
-//	we use ReadFrom/WriteBack to fetch the contents of the directory
+//	we use FetchFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//	Fixing this is one of the parts to the assignment.
-//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -25,6 +28,21 @@
 #include "filehdr.h"
 #include "directory.h"
 
+//----------------------------------------------------------------------
+// HashName
+// 	Hash a file name, to pick its bucket.
+//----------------------------------------------------------------------
+
+static unsigned int
+HashName(char *name)
+{
+    unsigned int hash = 5381;
+
+    while (*name != '\0')
+	hash = hash * 33 + (unsigned char) *name++;
+    return hash;
+}
+
 //----------------------------------------------------------------------
 // Directory::Directory
 // 	Initialize a directory; initially, the directory is completely
@@ -32,85 +50,165 @@
 //	is all we need, but otherwise, we need to call FetchFrom in order
 //	to initialize it from disk.
 //
-//	"size" is the number of entries in the directory
+//	"size" is the number of entries the directory should hold
+//	before it has to grow
 //----------------------------------------------------------------------
 
 Directory::Directory(int size)
 {
-    table = new DirectoryEntry[size];
-    tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-	table[i].inUse = FALSE;
+    header.numBuckets = max(BucketsFor(size), 1);
+    header.numEntries = header.numDeleted = 0;
+    header.parent = -1;
+    header.path[0] = '\0';
+    headerDirty = TRUE;
+    file = NULL;
+    buckets = new DirectoryEntry *[header.numBuckets];
+    dirty = new bool[header.numBuckets];
+    for (int i = 0; i < header.numBuckets; i++) {
+	buckets[i] = NULL;
+	dirty[i] = FALSE;
+    }
 }
 
 //----------------------------------------------------------------------
 // Directory::~Directory
-// 	De-allocate directory data structure.
+// 	De-allocate directory data structure.  Changes that were not
+//	written back are lost.
 //----------------------------------------------------------------------
 
 Directory::~Directory()
 { 
-    delete [] table;
+    for (int i = 0; i < header.numBuckets; i++)
+	if (buckets[i] != NULL)
+	    delete [] buckets[i];
+    delete [] buckets;
+    delete [] dirty;
 } 
 
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Attach to the directory stored in "dirFile".  Only its header is
+//	read now; buckets are read when a lookup needs them.
 //
-//	"file" -- file containing the directory contents
+//	"dirFile" -- file containing the directory contents
 //----------------------------------------------------------------------
 
 void
-Directory::FetchFrom(OpenFile *file)
+Directory::FetchFrom(OpenFile *dirFile)
 {
-    (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    for (int i = 0; i < header.numBuckets; i++)
+	if (buckets[i] != NULL)
+	    delete [] buckets[i];
+    delete [] buckets;
+    delete [] dirty;
+
+    (void) dirFile->ReadAt((char *)&header, sizeof(DirectoryHeader), 0);
+    ASSERT(header.numBuckets > 0);
+    file = dirFile;
+    headerDirty = FALSE;
+    buckets = new DirectoryEntry *[header.numBuckets];
+    dirty = new bool[header.numBuckets];
+    for (int i = 0; i < header.numBuckets; i++) {
+	buckets[i] = NULL;
+	dirty[i] = FALSE;
+    }
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write any modifications to the directory back to disk: the header,
+//	and the buckets that changed.  A new directory is written out
+//	whole.
 //
-//	"file" -- file to contain the new directory contents
+//	"dirFile" -- file to contain the new directory contents
 //----------------------------------------------------------------------
 
 void
-Directory::WriteBack(OpenFile *file)
+Directory::WriteBack(OpenFile *dirFile)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    if (file != dirFile) {		// new, or copied: write everything
+	for (int i = 0; i < header.numBuckets; i++) {
+	    Bucket(i);
+	    dirty[i] = TRUE;
+	}
+	headerDirty = TRUE;
+    }
+    if (headerDirty)
+	(void) dirFile->WriteAt((char *)&header, sizeof(DirectoryHeader), 0);
+    for (int i = 0; i < header.numBuckets; i++)	// in order, so the file
+	if (dirty[i]) {				// grows without holes
+	    (void) dirFile->WriteAt((char *)buckets[i], SectorSize,
+				    (i + 1) * SectorSize);
+	    dirty[i] = FALSE;
+	}
+    headerDirty = FALSE;
+    file = dirFile;
 }
 
 //----------------------------------------------------------------------
-// Directory::FindIndex
-// 	Look up file name in directory, and return its location in the table of
-//	directory entries.  Return -1 if the name isn't in the directory.
+// Directory::Bucket
+// 	Return bucket "b", reading it from disk the first time it is
+//	needed.  The buckets of a new directory start out empty.
+//----------------------------------------------------------------------
+
+DirectoryEntry *
+Directory::Bucket(int b)
+{
+    ASSERT(b >= 0 && b < header.numBuckets);
+    if (buckets[b] == NULL) {
+	buckets[b] = new DirectoryEntry[EntriesPerBucket];
+	if (file != NULL)
+	    (void) file->ReadAt((char *)buckets[b], SectorSize,
+				(b + 1) * SectorSize);
+	else
+	    bzero((char *)buckets[b], SectorSize);	// all EntryFree
+    }
+    return buckets[b];
+}
+
+//----------------------------------------------------------------------
+// Directory::FindEntry
+// 	Look up file name in the directory.  If it is there, return its
+//	entry; otherwise return the entry where it should be added (the
+//	first one along its search that isn't in use), or NULL if the
+//	table is full.  Either way, "*bucket" is set to the bucket the
+//	entry is in.
 //
 //	"name" -- the file name to look up
 //----------------------------------------------------------------------
 
-int
-Directory::FindIndex(char *name)
+DirectoryEntry *
+Directory::FindEntry(char *name, int *bucket)
 {
-    /*for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
-	    return i;
-    return -1;		// name not in directory*/
-    OpenFile* nameFile = new OpenFile(2);
-    int filelen = nameFile->hdr->FileLength();
-    char *buffer = new char[filelen+1];
-    nameFile->ReadAt(buffer, filelen, 0);
-    
-    for(int i=0; i<tableSize; ++i){
-        if(table[i].inUse){
-            char *tname = new char[table[i].length + 1];
-            for(int j=0; j<table[i].length; ++j){
-                tname[j] = buffer[table[i].offset + j];
-            }
-            tname[table[i].length] = '\0';
-            if(strcmp(name, tname) == 0)
-                return i;
-        }
+    DirectoryEntry *slot = NULL;
+    int start = HashName(name) % header.numBuckets;
+
+    for (int n = 0; n < header.numBuckets; n++) {
+	int b = (start + n) % header.numBuckets;
+	DirectoryEntry *entries = Bucket(b);
+	bool sawFree = FALSE;
+
+	for (int i = 0; i < EntriesPerBucket; i++) {
+	    DirectoryEntry *e = &entries[i];
+
+	    if (e->state == EntryInUse) {
+		if (!strncmp(e->name, name, FileNameMaxLen)) {
+		    *bucket = b;
+		    return e;
+		}
+	    } else {
+		if (slot == NULL) {
+		    slot = e;
+		    *bucket = b;
+		}
+		if (e->state == EntryFree)
+		    sawFree = TRUE;
+	    }
+	}
+	if (sawFree)			// it would have gone here
+	    break;
     }
-    return -1;
+    return slot;
 }
 
 //----------------------------------------------------------------------
@@ -120,58 +218,106 @@ Directory::FindIndex(char *name)
 //	in the directory.
 //
 //	"name" -- the file name to look up
+//	"isDir" -- if not NULL, set to whether the file is a directory
 //----------------------------------------------------------------------
 
 int
-Directory::Find(char *name)
+Directory::Find(char *name, bool *isDir)
 {
-    int i = FindIndex(name);
+    int b;
+    DirectoryEntry *e = FindEntry(name, &b);
 
-    if (i != -1)
-	return table[i].sector;
-    return -1;
+    if (e == NULL || e->state != EntryInUse)
+	return -1;
+    if (isDir != NULL)
+	*isDir = e->type;
+    return e->sector;
 }
 
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
-//	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	return FALSE if the file name is already in the directory, or
+//	is too long.  The table is doubled first if adding the name
+//	would make it more than 3/4 full.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"type" -- TRUE if the file is a directory
 //----------------------------------------------------------------------
 
 bool
 Directory::Add(char *name, int newSector, bool type)
 { 
-    if (FindIndex(name) != -1)
+    int b;
+    DirectoryEntry *e;
+
+    if (strlen(name) > FileNameMaxLen || Find(name) != -1)
 	return FALSE;
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            //strncpy(table[i].name, name, FileNameMaxLen);
-            table[i].sector = newSector;
-            table[i].type = type;
-            
-            OpenFile* nameFile = new OpenFile(2);
-            nameFile->setPosition(nameFile->hdr->FileLength());
-            int len = strlen(name);
-            table[i].offset = nameFile->hdr->FileLength();
-            table[i].length = len;
-            char* buffer = new char[len+1];
-            for(int j=0; j<len; ++j){
-                buffer[j] = name[j];
-            }
-            buffer[len] = '\0';
-            nameFile->Write(buffer, strlen(name));
-            
-            
-        return TRUE;
+    if (BucketsFor(header.numEntries + header.numDeleted + 1)
+						> header.numBuckets)
+	Grow(max(header.numBuckets, BucketsFor(2 * (header.numEntries + 1))));
+
+    e = FindEntry(name, &b);
+    ASSERT(e != NULL && e->state != EntryInUse);
+    if (e->state == EntryDeleted)
+	header.numDeleted--;
+    e->state = EntryInUse;
+    e->type = type;
+    e->sector = newSector;
+    strncpy(e->name, name, FileNameMaxLen);
+    e->name[FileNameMaxLen] = '\0';
+    header.numEntries++;
+    dirty[b] = headerDirty = TRUE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Directory::Grow
+// 	Move every entry into a new, empty table of "numBuckets" buckets
+//	(room for twice the entries there are, so growing is rare).
+//	This also clears out the Deleted entries.  All of it is written
+//	back, so the directory file grows to match.
+//----------------------------------------------------------------------
+
+void
+Directory::Grow(int numBuckets)
+{
+    int oldNum = header.numBuckets;
+    DirectoryEntry **oldBuckets = buckets;
+
+    DEBUG('f', "Growing directory %s to %d buckets\n", header.path,
+	  numBuckets);
+    for (int i = 0; i < oldNum; i++)		// read them all in
+	Bucket(i);
+    delete [] dirty;
+
+    header.numBuckets = numBuckets;
+    header.numEntries = header.numDeleted = 0;
+    buckets = new DirectoryEntry *[numBuckets];
+    dirty = new bool[numBuckets];
+    for (int i = 0; i < numBuckets; i++) {
+	buckets[i] = new DirectoryEntry[EntriesPerBucket];
+	bzero((char *)buckets[i], SectorSize);
+	dirty[i] = TRUE;
+    }
+    headerDirty = TRUE;
+
+    for (int i = 0; i < oldNum; i++) {
+	for (int j = 0; j < EntriesPerBucket; j++) {
+	    DirectoryEntry *old = &oldBuckets[i][j];
+	    int b;
+
+	    if (old->state != EntryInUse)
+		continue;
+	    DirectoryEntry *e = FindEntry(old->name, &b);
+	    *e = *old;
+	    header.numEntries++;
 	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+	delete [] oldBuckets[i];
+    }
+    delete [] oldBuckets;
 }
 
 //----------------------------------------------------------------------
@@ -185,12 +331,31 @@ Directory::Add(char *name, int newSector, bool type)
 bool
 Directory::Remove(char *name)
 { 
-    int i = FindIndex(name);
+    int b;
+    DirectoryEntry *e = FindEntry(name, &b);
 
-    if (i == -1)
+    if (e == NULL || e->state != EntryInUse)
 	return FALSE; 		// name not in directory
-    table[i].inUse = FALSE;
-    return TRUE;	
+    e->state = EntryDeleted;
+    header.numEntries--;
+    header.numDeleted++;
+    dirty[b] = headerDirty = TRUE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Directory::SetParent
+// 	Record where a new directory is: the header sector of the
+//	directory it is in, and its path from the root.
+//----------------------------------------------------------------------
+
+void
+Directory::SetParent(int sector, char *path)
+{
+    header.parent = sector;
+    strncpy(header.path, path, DirPathMaxLen);
+    header.path[DirPathMaxLen] = '\0';
+    headerDirty = TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -201,21 +366,13 @@ Directory::Remove(char *name)
 void
 Directory::List()
 {
-    OpenFile* nameFile = new OpenFile(2);
-    int filelen = nameFile->hdr->FileLength();
-    char *buffer = new char[filelen+1];
-    nameFile->ReadAt(buffer, filelen, 0);
-    
-   for (int i = 0; i < tableSize; i++)
-       if (table[i].inUse){
-           //printf("%s\n", table[i].name);
-           char *tname = new char[table[i].length + 1];
-           for(int j=0; j<table[i].length; ++j){
-               tname[j] = buffer[table[i].offset + j];
-           }
-           tname[table[i].length] = '\0';
-           printf("%s\n", tname);
-       }
+    for (int b = 0; b < header.numBuckets; b++) {
+	DirectoryEntry *entries = Bucket(b);
+
+	for (int i = 0; i < EntriesPerBucket; i++)
+	    if (entries[i].state == EntryInUse)
+		printf("%s\n", entries[i].name);
+    }
 }
 
 //----------------------------------------------------------------------
@@ -228,52 +385,37 @@ void
 Directory::Print()
 { 
     FileHeader *hdr = new FileHeader;
-    OpenFile* nameFile = new OpenFile(2);
-    int filelen = nameFile->hdr->FileLength();
-    char *buffer = new char[filelen+1];
-    nameFile->ReadAt(buffer, filelen, 0);
-    
+
     printf("Directory contents:\n");
-    for (int i = 1; i < tableSize; i++)
-	if (table[i].inUse) {
-        char *tname = new char[table[i].length + 1];
-        for(int j=0; j<table[i].length; ++j){
-            tname[j] = buffer[table[i].offset + j];
-        }
-        tname[table[i].length] = '\0';
-	    printf("Name: %s, Sector: %d\n", tname, table[i].sector);
-	    hdr->FetchFrom(table[i].sector);
-	    hdr->Print();
-	}
+    for (int b = 0; b < header.numBuckets; b++) {
+	DirectoryEntry *entries = Bucket(b);
+
+	for (int i = 0; i < EntriesPerBucket; i++)
+	    if (entries[i].state == EntryInUse) {
+		printf("Name: %s, Sector: %d\n", entries[i].name,
+		       entries[i].sector);
+		hdr->FetchFrom(entries[i].sector);
+		hdr->Print();
+	    }
+    }
     printf("\n");
     delete hdr;
 }
 
-void Directory::PrintPath(int sector){
-    FileHeader *hdr = new FileHeader;
-    OpenFile* nameFile = new OpenFile(2);
-    int filelen = nameFile->hdr->FileLength();
-    char *buffer = new char[filelen+1];
-    nameFile->ReadAt(buffer, filelen, 0);
-    
-    int len = table[0].length;
-    char *tname;
-    
-    for(int i=0; i<tableSize; ++i){
-        if(table[i].inUse && table[i].sector == sector){
-            len += table[i].length;
-            tname = new char[len + 2];
-            int j = 0;
-            for(int k=0; k<table[0].length; ++k, ++j){
-                tname[j] = buffer[table[0].offset + k];
-            }
-            tname[j] = '/';
-            j++;
-            for(int k=0; k<table[i].length; ++k, ++j){
-                tname[j] = buffer[table[i].offset + k];
-            }
-            tname[j] = '\0';
-            printf("File Path: %s\n", tname);
-        }
+//----------------------------------------------------------------------
+// Directory::PrintPath
+// 	Print the full name of the file whose header is at "sector", if
+//	it is in this directory.
+//----------------------------------------------------------------------
+
+void
+Directory::PrintPath(int sector)
+{
+    for (int b = 0; b < header.numBuckets; b++) {
+	DirectoryEntry *entries = Bucket(b);
+
+	for (int i = 0; i < EntriesPerBucket; i++)
+	    if (entries[i].state == EntryInUse && entries[i].sector == sector)
+		printf("File Path: %s/%s\n", header.path, entries[i].name);
     }
 }
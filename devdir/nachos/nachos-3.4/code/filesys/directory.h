@@ -6,6 +6,10 @@
 //	where to find its file header (the data structure describing
 //	where to find the file's data blocks) on disk.
 //
+//	The table is a hash table, one sector per bucket, that doubles
+//	in size as it fills up; so a directory can hold any number of
+//	files, and finding a name usually reads a single sector.
+//
 //      We assume mutual exclusion is provided by the caller.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
@@ -18,9 +22,17 @@
 #define DIRECTORY_H
 
 #include "openfile.h"
+#include "disk.h"
+
+#define FileNameMaxLen 		23	// for simplicity, we assume
+					// file names are <= 23 characters long
+#define DirPathMaxLen		111	// longest path kept for a directory
+
+// States of a directory entry.  A Deleted entry is free for reuse,
+// but, unlike a Free one, doesn't end a search: the name being looked
+// for may have been put further along when this entry was in use.
 
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+enum EntryState { EntryFree = 0, EntryInUse, EntryDeleted };
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
@@ -31,15 +43,31 @@
 
 class DirectoryEntry {
   public:
-    bool inUse;				// Is this directory entry in use?
+    char state;				// EntryFree, EntryInUse or EntryDeleted
+    bool type;				// 1 if directory, 0 if normal file
     int sector;				// Location on disk to find the 
 					//   FileHeader for this file 
-    //char name[FileNameMaxLen + 1];	// Text name for file, with +1 for
+    char name[FileNameMaxLen + 1];	// Text name for file, with +1 for
 					// the trailing '\0'
-    int offset;
-    int length; //last char is '\0'
-    
-    bool type; //1 if directory, 0 if normal file
+};
+
+#define EntriesPerBucket	((int) (SectorSize / sizeof(DirectoryEntry)))
+#define BucketsFor(n)		divRoundUp((n) * 4, EntriesPerBucket * 3)
+					// buckets to hold "n" entries, with
+					// the table at most 3/4 full
+
+// The first sector of a directory file says how big the table is, and
+// which directory this one is in.  The buckets follow it.
+
+class DirectoryHeader {
+  public:
+    int numBuckets;			// Sectors of entries after this one
+    int numEntries;			// Entries in use
+    int numDeleted;			// Entries in state EntryDeleted
+    int parent;				// Header sector of the parent
+					// directory (the root's is its own)
+    char path[DirPathMaxLen + 1];	// Name of this directory, from
+					// the root, for printing
 };
 
 // The following class defines a UNIX-like "directory".  Each entry in
@@ -48,9 +76,11 @@ class DirectoryEntry {
 // The directory data structure can be stored in memory, or on disk.
 // When it is on disk, it is stored as a regular Nachos file.
 //
-// The constructor initializes a directory structure in memory; the
-// FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// The constructor initializes an empty directory in memory;
+// FetchFrom attaches it to a directory on disk instead, after which
+// buckets are read in only as they are needed.  Changes are kept in
+// memory until WriteBack, so an operation that fails part way can
+// just delete the Directory.
 
 class Directory {
   public:
@@ -62,7 +92,8 @@ class Directory {
     void WriteBack(OpenFile *file);	// Write modifications to 
 					// directory contents back to disk
 
-    int Find(char *name);		// Find the sector number of the 
+    int Find(char *name, bool *isDir = NULL);
+					// Find the sector number of the
 					// FileHeader for file: "name"
 
     bool Add(char *name, int newSector, bool type);  // Add a file name into the directory
@@ -76,13 +107,24 @@ class Directory {
 					//  names and their contents.
     void PrintPath(int sector);
 
-  //private:
-    int tableSize;			// Number of directory entries
-    DirectoryEntry *table;		// Table of pairs: 
-					// <file name, file header location> 
-
-    int FindIndex(char *name);		// Find the index into the directory 
-					//  table corresponding to "name"
+    int GetParent() { return header.parent; }
+    char *GetPath() { return header.path; }
+    void SetParent(int sector, char *path);
+					// Say where a new directory is
+
+  private:
+    DirectoryHeader header;		// Size of the table, and parent
+    OpenFile *file;			// Where the buckets are on disk,
+					// NULL for a new directory
+    DirectoryEntry **buckets;		// Buckets read in so far, or NULL
+    bool *dirty;			// Which must be written back
+    bool headerDirty;
+
+    DirectoryEntry *Bucket(int b);	// Read in bucket "b" if need be
+    DirectoryEntry *FindEntry(char *name, int *bucket);
+					// Entry for "name", or where it
+					// would go if it isn't there
+    void Grow(int numBuckets);		// Rehash into a bigger table
 };
 
 #endif // DIRECTORY_H
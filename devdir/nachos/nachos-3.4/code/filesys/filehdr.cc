@@ -3,12 +3,17 @@
 //	would be called the i-node).
 //
 //	The file header is used to locate where on disk the 
-//	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	file's data is stored.  We implement this as a list of extents
+//	-- each a run of consecutive disk sectors, given by its first
+//	sector and length.  A few are kept in the header; the rest go in
+//	leaf blocks under single, double and triple indirect blocks,
+//	which are cached with the in-memory header.
+//
+//	Space is allocated in runs, from BitMap::FindRun: a growing file
+//	first tries to lengthen its last extent in place, and otherwise
+//	takes the best fitting free run, nearest the end of the file.
+//	So a file is usually a few long runs, and reading it sequentially
+//	costs few seeks.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -28,6 +33,47 @@
 #include "filehdr.h"
 #include "directory.h"
 
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	Initialize the in-memory part of a file header.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader()
+{
+    blocks = NULL;
+    ForgetCached();
+}
+
+//----------------------------------------------------------------------
+// FileHeader::~FileHeader
+// 	Free the index blocks cached with the header.  Changes not yet
+//	written back are lost.
+//----------------------------------------------------------------------
+
+FileHeader::~FileHeader()
+{
+    ForgetCached();
+}
+
+//----------------------------------------------------------------------
+// FileHeader::ForgetCached
+// 	Forget everything the in-memory header has read in or worked
+//	out, because the on-disk part is about to be replaced.
+//----------------------------------------------------------------------
+
+void
+FileHeader::ForgetCached()
+{
+    while (blocks != NULL) {
+        IndexBlock *next = blocks->next;
+
+        delete blocks;
+        blocks = next;
+    }
+    numExtents = -1;
+    lastExtent = lastBase = 0;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
@@ -42,55 +88,24 @@
 bool
 FileHeader::Allocate(BitMap *freeMap, int fileSize)
 {
-    //printf("%d\n", NumDirect);
-    //printf("?\n");
     numBytes = fileSize;
     numSectors  = divRoundUp(fileSize, SectorSize);
     if (freeMap->NumClear() < numSectors)
 	return FALSE;		// not enough space
 
-    /*int block_begin = freeMap->MyFind(numSectors);
-    if(block_begin != -1){
-        for(int i=0; i<numSectors; ++i)
-            dataSectors[i] = block_begin + i;
-        return TRUE;
-    }*/
-    
-    if(numSectors <= NumDirect){
-        for (int i=0; i<numSectors; ++i)
-            dataSectors[i] = freeMap->Find();
-    }
-    else{
-        for(int i=0; i<NumDirect; ++i)
-            dataSectors[i] = freeMap->Find();
-        dataSectors[NumDirect] = freeMap->Find();
-        int lastSectors = numSectors - NumDirect;
-        int index[32];
-        if(lastSectors<=32){
-            for(int i=0; i<lastSectors; ++i)
-                index[i] = freeMap->Find();
-        }
-        else{
-            for(int i=0; i<32; ++i)
-                index[i] = freeMap->Find();
-        }
-        synchDisk->WriteSector(dataSectors[NumDirect], (char*)index);
-        lastSectors -= 32;
-        if(lastSectors > 0){
-            dataSectors[NumDirect+1] = freeMap->Find();
-            int index1[32];
-            for(int i=0; i<lastSectors; ++i)
-                index1[i] = freeMap->Find();
-            synchDisk->WriteSector(dataSectors[NumDirect+1], (char*)index1);
-        }
-    }
-    //printf("?\n");
-    return TRUE;
+    for (int i = 0; i < NumExtents; i++)
+        extents[i].start = extents[i].length = 0;
+    for (int i = 0; i < NumLevels; i++)
+        indirect[i] = -1;
+    ForgetCached();
+    numExtents = 0;
+    return AddSectors(freeMap, numSectors);
 }
 
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and for the indirect blocks describing them.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
@@ -98,42 +113,43 @@ FileHeader::Allocate(BitMap *freeMap, int fileSize)
 void 
 FileHeader::Deallocate(BitMap *freeMap)
 {
-    if(numSectors <= NumDirect){
-        for (int i = 0; i < numSectors; i++) {
-            ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-            freeMap->Clear((int) dataSectors[i]);
+    for (int i = 0, done = 0; done < numSectors; i++) {
+        Extent *e = GetExtent(i);
+
+        for (int j = 0; j < e->length; j++) {
+            ASSERT(freeMap->Test(e->start + j));  // ought to be marked!
+            freeMap->Clear(e->start + j);
         }
+        done += e->length;
     }
-    else{
-        for(int i=0; i<NumDirect; ++i)
-            freeMap->Clear((int) dataSectors[i]);
-        int lastSectors = numSectors - NumDirect;
-        char* index = new char[SectorSize];
-        synchDisk->ReadSector(dataSectors[NumDirect], index);
-        if(lastSectors <= 32){
-            for(int i=0; i<lastSectors; ++i)
-                freeMap->Clear((int)index[i*4]);
-        }
-        else{
-            for(int i=0; i<32; ++i)
-                freeMap->Clear((int)index[i*4]);
-        }
-        lastSectors -= 32;
-        if(lastSectors > 0){
-            char* index1 = new char[SectorSize];
-            synchDisk->ReadSector(dataSectors[NumDirect+1], index1);
-            for(int i=0; i<lastSectors; ++i)
-                freeMap->Clear((int)index1[i*4]);
-        }
-        freeMap->Clear((int) dataSectors[NumDirect]);
-        if(numSectors > NumDirect + 32)
-            freeMap->Clear((int) dataSectors[NumDirect+1]);
+    for (int i = 0; i < NumLevels; i++)
+        FreeTree(freeMap, indirect[i], i);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FreeTree
+// 	Free the indirect block at "sector", and, if it is a pointer block
+//	("level" > 0), the blocks below it.
+//----------------------------------------------------------------------
+
+void
+FileHeader::FreeTree(BitMap *freeMap, int sector, int level)
+{
+    if (sector == -1)
+        return;
+    if (level > 0) {
+        int *ptrs = Block(sector, FALSE, FALSE);
+
+        for (int i = 0; i < PtrsPerBlock; i++)
+            FreeTree(freeMap, ptrs[i], level - 1);
     }
+    freeMap->Clear(sector);
 }
 
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk. 
+// 	Fetch contents of file header from disk.  Indirect blocks are
+//	read later, if they are needed.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
@@ -142,11 +158,13 @@ void
 FileHeader::FetchFrom(int sector)
 {
     synchDisk->ReadSector(sector, (char *)this);
+    ForgetCached();
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk. 
+// 	Write the modified contents of the file header back to disk,
+//	along with any indirect blocks that have changed.
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
@@ -155,6 +173,176 @@ void
 FileHeader::WriteBack(int sector)
 {
     synchDisk->WriteSector(sector, (char *)this); 
+    for (IndexBlock *b = blocks; b != NULL; b = b->next)
+        if (b->dirty) {
+            synchDisk->WriteSector(b->sector, (char *)b->data);
+            b->dirty = FALSE;
+        }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Block
+// 	Return the contents of the indirect block at "sector", reading it
+//	in the first time.  A "fresh" block was just allocated: fill it
+//	with -1 instead of reading it.  If "dirty", it is about to be
+//	changed, and must be written back.
+//----------------------------------------------------------------------
+
+int *
+FileHeader::Block(int sector, bool fresh, bool dirty)
+{
+    IndexBlock *b;
+
+    for (b = blocks; b != NULL; b = b->next)
+        if (b->sector == sector)
+            break;
+    if (b == NULL) {
+        b = new IndexBlock;
+        b->sector = sector;
+        b->dirty = FALSE;
+        if (fresh)
+            for (int i = 0; i < PtrsPerBlock; i++)
+                b->data[i] = -1;
+        else
+            synchDisk->ReadSector(sector, (char *)b->data);
+        b->next = blocks;
+        blocks = b;
+    }
+    if (dirty)
+        b->dirty = TRUE;
+    return b->data;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::GetExtent
+// 	Return extent "i" of the file.  Past the ones in the header, find
+//	its leaf block by walking down from the single, double or triple
+//	indirect block, whichever covers "i".
+//
+//	If "freeMap" is given, the caller is about to change the extent:
+//	allocate any block on the way that doesn't exist yet, and mark
+//	the leaf dirty.  Return NULL if the disk is full.
+//----------------------------------------------------------------------
+
+Extent *
+FileHeader::GetExtent(int i, BitMap *freeMap)
+{
+    int path[NumLevels];		// pointer to follow at each level
+    int level, span = ExtentsPerBlock;
+    int *slot, parent;			// next pointer, and the block it's in
+
+    ASSERT(i >= 0 && i < MaxExtents);
+    if (i < NumExtents)
+        return &extents[i];
+    i -= NumExtents;
+    for (level = 0; i >= span; level++) {	// which tree is it in?
+        i -= span;
+        span *= PtrsPerBlock;
+    }
+    for (int l = level; l > 0; l--) {		// and which way down?
+        span /= PtrsPerBlock;
+        path[l] = i / span;
+        i %= span;
+    }
+
+    slot = &indirect[level];
+    parent = -1;
+    for (int l = level; ; l--) {
+        bool fresh = FALSE;
+
+        if (*slot == -1) {			// not allocated yet
+            ASSERT(freeMap != NULL);
+            *slot = freeMap->Find();
+            if (*slot == -1)
+                return NULL;
+            fresh = TRUE;
+            if (parent != -1)			// it has a new pointer
+                Block(parent, FALSE, TRUE);
+        }
+        int *data = Block(*slot, fresh, fresh || (l == 0 && freeMap != NULL));
+        if (l == 0) {
+            if (fresh)				// no extents in it yet
+                bzero((char *)data, SectorSize);
+            return &((Extent *)data)[i];
+        }
+        parent = *slot;
+        slot = &data[path[l]];
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::AddSectors
+// 	Allocate "num" more sectors at the end of the file, out of
+//	"freeMap".  First grow the last extent, if the sectors after it
+//	are free; then add new extents, asking the bitmap for runs near
+//	where the file ends.  Return FALSE if the disk, or the extent
+//	list, is full; then every data sector taken so far is given back,
+//	so the extents describe no more than they did.  (An index block
+//	allocated on the way stays, empty; Deallocate frees it.)
+//----------------------------------------------------------------------
+
+bool
+FileHeader::AddSectors(BitMap *freeMap, int num)
+{
+    int oldExtents, oldLength = 0;
+
+    if (numExtents < 0) {			// count them
+        numExtents = 0;
+        for (int done = 0; done < numSectors - num; numExtents++)
+            done += GetExtent(numExtents)->length;
+    }
+    oldExtents = numExtents;
+
+    Extent *last = (numExtents > 0) ? GetExtent(numExtents - 1, freeMap)
+                                     : NULL;
+    if (last != NULL) {
+        int next = last->start + last->length;
+
+        oldLength = last->length;
+
+        while (num > 0 && next < NumSectors && !freeMap->Test(next)) {
+            freeMap->Mark(next++);
+            last->length++;
+            num--;
+        }
+    }
+
+    while (num > 0) {
+        int hint = (last != NULL) ? last->start + last->length : -1;
+        int start, length;
+        Extent *e;
+
+        if (numExtents == MaxExtents)
+            break;
+        e = GetExtent(numExtents, freeMap);
+        if (e == NULL)
+            break;				// no room for indirect block
+        start = freeMap->FindRun(num, hint, &length);
+        if (start == -1)
+            break;
+        numExtents++;
+        e->start = start;
+        e->length = length;
+        num -= length;
+        last = e;
+    }
+    if (num == 0)
+        return TRUE;
+
+    while (numExtents > oldExtents) {		// out of room: undo
+        Extent *e = GetExtent(--numExtents, freeMap);
+
+        for (int j = 0; j < e->length; j++)
+            freeMap->Clear(e->start + j);
+        e->start = e->length = 0;
+    }
+    if (oldExtents > 0) {
+        Extent *e = GetExtent(oldExtents - 1, freeMap);
+
+        while (e->length > oldLength)
+            freeMap->Clear(e->start + --e->length);
+    }
+    return FALSE;
 }
 
 //----------------------------------------------------------------------
@@ -164,30 +352,27 @@ FileHeader::WriteBack(int sector)
 //	offset in the file) to a physical address (the sector where the
 //	data at the offset is stored).
 //
+//	The search starts from the extent the last call found, so
+//	sequential access costs nothing beyond an addition.
+//
 //	"offset" is the location within the file of the byte in question
 //----------------------------------------------------------------------
 
 int
 FileHeader::ByteToSector(int offset)
 {
-    //return(dataSectors[offset / SectorSize]);
-    int sector = offset/SectorSize;
-    if(sector<NumDirect){
-        //printf("0\n");
-        return dataSectors[sector];
-    }
-    else if(sector >= NumDirect && sector < NumDirect+32){
-        //printf("1\n");
-        int index[32];
-        synchDisk->ReadSector(dataSectors[NumDirect], (char*)index);
-        return index[sector - NumDirect];
-    }
-    else if(sector >= NumDirect+32 && sector < NumDirect+64){
-        //printf("2\n");
-        int index[32];
-        synchDisk->ReadSector(dataSectors[NumDirect+1], (char*)index);
-        return index[sector - NumDirect-32];
+    int sector = offset / SectorSize;
+    Extent *e;
+
+    ASSERT(sector >= 0 && sector < numSectors);
+    if (sector < lastBase)
+        lastExtent = lastBase = 0;
+    e = GetExtent(lastExtent);
+    while (sector >= lastBase + e->length) {
+        lastBase += e->length;
+        e = GetExtent(++lastExtent);
     }
+    return e->start + (sector - lastBase);
 }
 
 //----------------------------------------------------------------------
@@ -219,50 +404,21 @@ FileHeader::Print()
     if(hdr_sector==0||hdr_sector==1||hdr_sector==2||hdr_sector==4)
         flag = 1;
     
-    if(numSectors <= NumDirect){
-        for (i = 0; i < numSectors; ++i){
-            printf("%d ", dataSectors[i]);
-            //if(hdr_sector==4||dataSectors[i]==5||dataSectors[i]==7||dataSectors[i]==9)
-                //flag = 1;
-            if(dataSectors[i]==8)
-                flag = 1;
-        }
-    }
-    else{
-        for (i = 0; i < NumDirect; ++i){
-            printf("%d ", dataSectors[i]);
-            //if(dataSectors[i]==4||dataSectors[i]==5||dataSectors[i]==7||dataSectors[i]==9)
-                //flag = 1;
-            if(dataSectors[i] == 8)
-                flag = 1;
-        }
-        int lastSectors = numSectors - NumDirect;
-        int index[32];
-        synchDisk->ReadSector(dataSectors[NumDirect], (char*)index);
-        if(lastSectors<=32){
-            for(int i=0; i<lastSectors; ++i)
-                printf("%d ", index[i]);
-        }
-        else{
-            for(int i=0; i<32; ++i)
-                printf("%d ", index[i]);
-        }
-        lastSectors -= 32;
-        if(lastSectors > 0){
-            int index1[32];
-            synchDisk->ReadSector(dataSectors[NumDirect+1], (char*)index1);
-            for(int i=0; i<lastSectors; ++i)
-                printf("%d ", index1[i]);
-        }
+    for (i = 0; i < numSectors; ++i){
+        int sector = ByteToSector(i * SectorSize);
+
+        printf("%d ", sector);
+        if(sector == 8)
+            flag = 1;
     }
     printf("\n");
     
-    if(flag == 0){
-        OpenFile *curDirec = new OpenFile(3);
-        Directory *dd = new Directory(10);
-        dd->FetchFrom(curDirec);
+    if(flag == 0 && fileSystem != NULL){
+        Directory *dd = new Directory(0);
+        dd->FetchFrom(fileSystem->curDirectoryFile);
         
         dd->PrintPath(hdr_sector);
+        delete dd;
     }
     
     if(flag == 0)
@@ -273,158 +429,39 @@ FileHeader::Print()
         printTime();
     
     printf("File contents:\n");
-    if(numSectors <= NumDirect){
-        for (i = k = 0; i < numSectors; i++) {
-            synchDisk->ReadSector(dataSectors[i], data);
-            for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
-                if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
-                    printf("%c", data[j]);
-                else
-                    printf("\\%x", (unsigned char)data[j]);
-            }
-            printf("\n");
-        }
-    }
-    else{
-        for (i = k = 0; i < NumDirect; i++) {
-            synchDisk->ReadSector(dataSectors[i], data);
-            for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
-                if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
-                    printf("%c", data[j]);
-                else
-                    printf("\\%x", (unsigned char)data[j]);
-            }
-            printf("\n");
-        }
-        int lastSectors = numSectors - NumDirect;
-        int index[32];
-        synchDisk->ReadSector(dataSectors[NumDirect], (char*)index);
-        if(lastSectors<=32){
-            for(i = k = 0; i < lastSectors; ++i){
-                synchDisk->ReadSector(index[i], data);
-                for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
-                    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
-                        printf("%c", data[j]);
-                    else
-                        printf("\\%x", (unsigned char)data[j]);
-                }
-                printf("\n");
-            }
-        }
-        else{
-            for(i = k = 0; i < 32; ++i){
-                synchDisk->ReadSector(index[i], data);
-                for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
-                    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
-                        printf("%c", data[j]);
-                    else
-                        printf("\\%x", (unsigned char)data[j]);
-                }
-                printf("\n");
-            }
-        }
-        //printf("\n?\n");
-        lastSectors -= 32;
-        if(lastSectors > 0){
-            int index1[32];
-            synchDisk->ReadSector(dataSectors[NumDirect+1], (char*)index1);
-            for(i = k = 0; i < lastSectors; ++i){
-                synchDisk->ReadSector(index1[i], data);
-                for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
-                    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
-                        printf("%c", data[j]);
-                    else
-                        printf("\\%x", (unsigned char)data[j]);
-                }
-                printf("\n");
-            }
+    for (i = k = 0; i < numSectors; i++) {
+        synchDisk->ReadSector(ByteToSector(i * SectorSize), data);
+        for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
+            if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
+                printf("%c", data[j]);
+            else
+                printf("\\%x", (unsigned char)data[j]);
         }
+        printf("\n");
     }
     printf("\n");
     delete [] data;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Grow the file by "bytes", allocating data sectors for it out of
+//	"freeMap" (see AddSectors).  Return FALSE if there isn't room,
+//	leaving the file as it was.  As with Allocate, the caller writes
+//	the header back.
+//----------------------------------------------------------------------
+
 bool FileHeader::Extend(BitMap *freeMap, int bytes){
-    numBytes += bytes;
+    int originBytes = numBytes;
     int originNum = numSectors;
+    numBytes += bytes;
     numSectors = divRoundUp(numBytes, SectorSize);
     if(originNum == numSectors)
         return TRUE;
-    else if(freeMap->NumClear() < numSectors - originNum)
-        return FALSE;
-    int needed = numSectors - originNum;
-    if(numSectors <= NumDirect){
-        for(int i=originNum; i<numSectors; ++i){
-            dataSectors[i] = freeMap->Find();
-            //printf("%d\n", dataSectors[i]);
-            needed--;
-        }
-    }
-    else{ //numSectors > NumDirect
-        if(originNum<=NumDirect){
-            dataSectors[NumDirect] = freeMap->Find();
-            int index[32];
-            int tn = needed;
-            if(tn <= 32){
-                for(int i=0; i<tn; ++i){
-                    index[i] = freeMap->Find();
-                    needed--;
-                }
-            }
-            else{
-                for(int i=0; i<32; ++i){
-                    index[i] = freeMap->Find();
-                    needed--;
-                }
-            }
-            synchDisk->WriteSector(dataSectors[NumDirect], (char*)index);
-            if(needed>0){
-                dataSectors[NumDirect+1] = freeMap->Find();
-                int index1[32];
-                tn = needed;
-                for(int i=0; i<tn; ++i){
-                    index1[i] = freeMap->Find();
-                    needed--;
-                }
-                synchDisk->WriteSector(dataSectors[NumDirect+1], (char*)index1);
-            }
-        }
-        else if(originNum>NumDirect && originNum<=(NumDirect+32)){
-            int index[32];
-            synchDisk->ReadSector(dataSectors[NumDirect], (char*)index);
-            int begin = originNum - NumDirect;
-            int tn = needed;
-            for(int i=0; i<tn; ++i){
-                if(begin + i == 32){
-                    break;
-                }
-                index[begin+i] = freeMap->Find();
-                needed--;
-            }
-            synchDisk->WriteSector(dataSectors[NumDirect], (char*)index);
-            if(needed > 0){
-                int index1[32];
-                dataSectors[NumDirect+1] = freeMap->Find();
-                tn = needed;
-                for(int i=0; i<tn; ++i){
-                    index1[i] = freeMap->Find();
-                    needed--;
-                }
-                synchDisk->WriteSector(dataSectors[NumDirect+1], (char*)index1);
-            }
-        }
-        else if(originNum>(NumDirect+32) && originNum<=(NumDirect+64)){
-            int index1[32];
-            synchDisk->ReadSector(dataSectors[NumDirect+1], (char*)index1);
-            int begin = originNum - NumDirect-32;
-            int tn = needed;
-            for(int i=0; i<tn; ++i){
-                index1[begin+i] = freeMap->Find();
-                needed--;
-            }
-            synchDisk->WriteSector(dataSectors[NumDirect+1], (char*)index1);
-        }
-    }
-    
-    return TRUE;
+    if(freeMap->NumClear() >= numSectors - originNum &&
+       AddSectors(freeMap, numSectors - originNum))
+        return TRUE;
+    numBytes = originBytes;		// claim no sectors we don't own
+    numSectors = originNum;
+    return FALSE;
 }
@@ -19,29 +19,66 @@
 #include "disk.h"
 #include "bitmap.h"
 
-//#define NumDirect  ((SectorSize - 2 * sizeof(int) - 75 - 5) / sizeof(int)) - 2
-#define NumDirect 7
-#define NumMap 9
-#define NumIndirect 2
-#define MaxFileSize 	(NumDirect * SectorSize)
+#define NumExtents	3		// extents kept in the header itself
+#define NumLevels	3		// single, double, triple indirect
+#define PtrsPerBlock	((int) (SectorSize / sizeof(int)))
+					// sector numbers in a pointer block
+#define ExtentsPerBlock	((int) (SectorSize / sizeof(Extent)))
+					// extents in a leaf block
+#define MaxExtents	(NumExtents + ExtentsPerBlock			\
+			 + PtrsPerBlock * ExtentsPerBlock		\
+			 + PtrsPerBlock * PtrsPerBlock * ExtentsPerBlock)
+
+// A run of consecutive disk sectors holding consecutive file data.
+
+class Extent {
+  public:
+    int start;				// first sector of the run
+    int length;				// number of sectors in it
+};
+
+// An indirect block, as kept in memory with its file header: either
+// PtrsPerBlock sector numbers of lower-level blocks (-1 if unused),
+// or ExtentsPerBlock extents.
+
+class IndexBlock {
+  public:
+    int sector;				// where it lives on disk
+    int data[PtrsPerBlock];		// its contents
+    bool dirty;				// must it be written back?
+    IndexBlock *next;			// next block cached by this header
+};
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The file header is organized as a list of extents -- runs of
+// consecutive sectors -- in file order.  The first NumExtents are in
+// the header; the rest are in leaf blocks of ExtentsPerBlock extents,
+// reached through a single, double or triple indirect pointer in the
+// header, as in UNIX.  Even a file scattered one sector at a time
+// over the whole disk can be described.  Because the allocator looks
+// for contiguous free space, though, most files are one or two
+// extents long and never need an indirect block at all.
 //
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
 // that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// as one disk sector.
+//
+// The file header can be initialized by allocating blocks for the
+// file (if it is a new file), or by reading it from disk.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// Indirect blocks are read in the first time they are needed and kept
+// with the in-memory header; changes to them are written back with the
+// header.  Only the first SectorSize bytes of the object go to disk.
+
+class IndexBlock;
 
 class FileHeader {
   public:
+    FileHeader();			// No index blocks loaded yet
+    ~FileHeader();			// Free the cached index blocks
+
     bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
 						//  including allocating space 
 						//  on disk for the file data
@@ -116,8 +153,29 @@ class FileHeader {
   private:
     int numBytes;			// Number of bytes in the file
     int numSectors;			// Number of data sectors in the file
-    int dataSectors[NumMap];		// Disk sector numbers for each data
-					// block in the file
+    Extent extents[NumExtents];		// Where the file's data is, in
+					// order; unused ones have length 0
+    int indirect[NumLevels];		// Roots of the single, double and
+					// triple indirect trees, -1 if none
+
+    // The rest is kept in memory only.
+    void ForgetCached();		// Nothing read in or counted yet
+    Extent *GetExtent(int i, BitMap *freeMap = NULL);
+					// Extent i, wherever it is kept.
+					// With "freeMap", it is about to be
+					// changed: allocate missing blocks
+    int *Block(int sector, bool fresh, bool dirty);
+					// Cached contents of an index block
+    void FreeTree(BitMap *freeMap, int sector, int level);
+    bool AddSectors(BitMap *freeMap, int num);
+					// Allocate "num" more sectors to
+					// the end of the file
+
+    IndexBlock *blocks;			// index blocks read in so far
+    int numExtents;			// extents in use, -1 if not counted
+    int lastExtent, lastBase;		// extent found by the last
+					// ByteToSector, and its first
+					// sector within the file
 };
 
 #endif // FILEHDR_H
@@ -32,9 +32,6 @@
 //
 //	   there is no synchronization for concurrent accesses
 //	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
 //	   there is no attempt to make the system robust to failures
 //	    (if Nachos exits in the middle of an operation that modifies
 //	    the file system, it may corrupt the disk)
@@ -46,11 +43,13 @@
 #include "copyright.h"
 #include "time.h"
 #include "disk.h"
-#include "bitmap.h"
+#include "freemap.h"
+#include "dcache.h"
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
 #include "system.h"
+#include "synch.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known 
@@ -61,12 +60,11 @@
 #define CurDirecSector      3
 #define PipeSector          4
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
+// Initial file sizes for the bitmap and directory.  A directory starts
+// with room for NumDirEntries files, and grows when it fills up.
 #define FreeMapFileSize 	(NumSectors / BitsInByte)
 #define NumDirEntries 		10
-#define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
+#define DirectoryFileSize 	(SectorSize * (1 + BucketsFor(NumDirEntries)))
 
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
@@ -84,8 +82,11 @@
 FileSystem::FileSystem(bool format)
 { 
     DEBUG('f', "Initializing the file system.\n");
+    dirLock = new RWLock("directory");
+    freeMapLock = new RWLock("free map");
+    dcache = new DentryCache(DentryCacheSize);
+    freeMap = new FreeMap(NumSectors);
     if (format) {
-        BitMap *freeMap = new BitMap(NumSectors);
         Directory *directory = new Directory(NumDirEntries);
 	FileHeader *mapHdr = new FileHeader;
 	FileHeader *dirHdr = new FileHeader;
@@ -109,7 +110,8 @@ FileSystem::FileSystem(bool format)
 	ASSERT(mapHdr->Allocate(freeMap, FreeMapFileSize));
 	ASSERT(dirHdr->Allocate(freeMap, DirectoryFileSize));
     ASSERT(namHdr->Allocate(freeMap, 0));
-    ASSERT(curHdr->Allocate(freeMap, DirectoryFileSize));
+    ASSERT(curHdr->Allocate(freeMap, 0));	// just says which directory
+						// is the current one
     ASSERT(pipHdr->Allocate(freeMap, 0));
     namHdr->hdr_sector = NameSector;
     curHdr->hdr_sector = 1;
@@ -136,8 +138,8 @@ FileSystem::FileSystem(bool format)
         freeMapFile = new OpenFile(FreeMapSector);
         directoryFile = new OpenFile(DirectorySector);
         nameFile = new OpenFile(NameSector);
-        curDirectoryFile = new OpenFile(CurDirecSector);
-        //curDirectoryFile->hdr->hdr_sector = 1;
+        curDirectoryFile = new OpenFile(DirectorySector);
+        curDirSector = DirectorySector;
      
     // Once we have the files "open", we can write the initial version
     // of each file back to disk.  The directory at this point is completely
@@ -148,20 +150,13 @@ FileSystem::FileSystem(bool format)
         DEBUG('f', "Writing bitmap and directory back to disk.\n");
 	freeMap->WriteBack(freeMapFile);	 // flush changes to disk
     
-        char buffer[] = "root";
-        nameFile->Write(buffer, strlen(buffer));
-        directory->table[0].inUse = TRUE;
-        directory->table[0].offset = 0;
-        directory->table[0].length = 4;
-        directory->table[0].sector = 1;
+        directory->SetParent(DirectorySector, "root");
         directory->WriteBack(directoryFile);
-        directory->WriteBack(curDirectoryFile);
         
 	if (DebugIsEnabled('f')) {
 	    freeMap->Print();
 	    directory->Print();
 
-        delete freeMap; 
 	delete directory; 
 	delete mapHdr; 
 	delete dirHdr;
@@ -171,10 +166,16 @@ FileSystem::FileSystem(bool format)
     } else {
     // if we are not formatting the disk, just open the files representing
     // the bitmap and directory; these are left open while Nachos is running
+        FileHeader *curHdr = new FileHeader;
+
+        curHdr->FetchFrom(CurDirecSector);
         freeMapFile = new OpenFile(FreeMapSector);
+        freeMap->FetchFrom(freeMapFile);	// once, for good
         directoryFile = new OpenFile(DirectorySector);
         nameFile = new OpenFile(NameSector);
-        curDirectoryFile = new OpenFile(CurDirecSector);
+        curDirectoryFile = new OpenFile(curHdr->hdr_sector);
+        curDirSector = curHdr->hdr_sector;
+        delete curHdr;
     }
 }
 
@@ -195,6 +196,8 @@ FileSystem::FileSystem(bool format)
 //	Return TRUE if everything goes ok, otherwise, return FALSE.
 //
 // 	Create fails if:
+//		the name has a '/' in it (files are made in the current
+//		directory only)
 //   		file is already in directory
 //	 	no free space for file header
 //	 	no free entry for file in directory
@@ -211,13 +214,16 @@ bool
 FileSystem::Create(char *name, int initialSize)
 {
     Directory *directory;
-    BitMap *freeMap;
     FileHeader *hdr;
     int sector;
     bool success;
 
     DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    if (strchr(name, '/') != NULL)
+	return FALSE;			// not a name in this directory
 
+    dirLock->AcquireWrite();
+    freeMapLock->AcquireWrite();
     directory = new Directory(NumDirEntries);
     //directory->FetchFrom(directoryFile);
     directory->FetchFrom(curDirectoryFile);
@@ -225,8 +231,7 @@ FileSystem::Create(char *name, int initialSize)
     if (directory->Find(name) != -1)
       success = FALSE;			// file is already in directory
     else {	
-        freeMap = new BitMap(NumSectors);
-        freeMap->FetchFrom(freeMapFile);
+        freeMap->Begin();		// so a failure can be undone
         sector = freeMap->Find();	// find a sector to hold the file header
     	if (sector == -1) 		
             success = FALSE;		// no free block for file header 
@@ -252,15 +257,19 @@ FileSystem::Create(char *name, int initialSize)
             hdr->hdr_sector = sector;
             
     	    	hdr->WriteBack(sector); 		
-    	    	//directory->WriteBack(directoryFile);
-                directory->WriteBack(curDirectoryFile);
-    	    	freeMap->WriteBack(freeMapFile);
-	    }
+    	    	directory->WriteBack(curDirectoryFile);	// may grow, so the
+    	    	dcache->Enter(curDirSector, name, sector, FALSE);
+	    }					// bitmap goes last
             delete hdr;
 	}
-        delete freeMap;
+        if (success)
+            freeMap->Commit(freeMapFile);
+        else
+            freeMap->Abort();
     }
     delete directory;
+    freeMapLock->ReleaseWrite();
+    dirLock->ReleaseWrite();
     return success;
 }
 
@@ -268,15 +277,19 @@ bool
 FileSystem::CreateDir(char *name, int initialSize)
 {
     Directory *directory;
-    BitMap *freeMap;
     FileHeader *hdr;
     int sector;
     bool success;
-    FileHeader *curHdr = new FileHeader;
-    curHdr->FetchFrom(3);
+    FileHeader *curHdr;
     
     DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    if (strchr(name, '/') != NULL)
+        return FALSE;               // not a name in this directory
+    curHdr = new FileHeader;
+    curHdr->FetchFrom(3);
     
+    dirLock->AcquireWrite();
+    freeMapLock->AcquireWrite();
     directory = new Directory(NumDirEntries);
     //directory->FetchFrom(directoryFile);
     directory->FetchFrom(curDirectoryFile);
@@ -284,8 +297,7 @@ FileSystem::CreateDir(char *name, int initialSize)
     if (directory->Find(name) != -1)
         success = FALSE;            // file is already in directory
     else {
-        freeMap = new BitMap(NumSectors);
-        freeMap->FetchFrom(freeMapFile);
+        freeMap->Begin();            // so a failure can be undone
         sector = freeMap->Find();    // find a sector to hold the file header
         if (sector == -1)
             success = FALSE;        // no free block for file header
@@ -313,50 +325,33 @@ FileSystem::CreateDir(char *name, int initialSize)
                 
                 hdr->WriteBack(sector);
                 
-                //if(type){
-                    //Directory *directory = new Directory(NumDirEntries);
-                    OpenFile* namFile = new OpenFile(2);
-                    int filelen = namFile->hdr->FileLength();
-                    char *buffer = new char[filelen+1];
-                    namFile->ReadAt(buffer, filelen, 0);
-                    
-                    int ll = strlen(name);
-                    int j;
-                    char *tname = new char[ll + directory->table[0].length + 2];
-                    for(j=0; j<directory->table[0].length; ++j){
-                        tname[j] = buffer[directory->table[0].offset + j];
-                    }
-                    tname[j] = '/';
-                    j++;
-                    for(int i=0; i<ll; ++i, ++j){
-                        tname[j] = name[i];
-                    }
-                    tname[j]='\0';
-                    
-                    Directory *dd = new Directory(NumDirEntries);
-                    dd->table[0].inUse = TRUE;
-                    namFile->setPosition(namFile->hdr->FileLength());
-                    int len = strlen(tname);
-                    dd->table[0].offset = namFile->hdr->FileLength();
-                    dd->table[0].length = len;
-                    dd->table[0].sector = curHdr->hdr_sector;
-                
-                    namFile->Write(tname, strlen(tname));
-                    
-                    OpenFile* fff = new OpenFile(sector);
-                    dd->WriteBack(fff);
-                //}
-                curHdr->WriteBack(3);
-                hdr->WriteBack(sector);
-                //directory->WriteBack(directoryFile);
+                char *path = new char[strlen(directory->GetPath())
+                                      + strlen(name) + 2];
+                sprintf(path, "%s/%s", directory->GetPath(), name);
+
+                Directory *dd = new Directory(NumDirEntries);
+                dd->SetParent(curHdr->hdr_sector, path);
+                OpenFile* fff = new OpenFile(sector);
+                dd->WriteBack(fff);
+                delete fff;
+                delete dd;
+                delete [] path;
+
+                // the bitmap goes last: if the directory has to
+                // grow, its file takes more sectors
                 directory->WriteBack(curDirectoryFile);
-                freeMap->WriteBack(freeMapFile);
+                dcache->Enter(curDirSector, name, sector, TRUE);
             }
             delete hdr;
         }
-        delete freeMap;
+        if (success)
+            freeMap->Commit(freeMapFile);
+        else
+            freeMap->Abort();
     }
     delete directory;
+    freeMapLock->ReleaseWrite();
+    dirLock->ReleaseWrite();
     return success;
 }
 
@@ -364,29 +359,110 @@ FileSystem::CreateDir(char *name, int initialSize)
 // FileSystem::Open
 // 	Open a file for reading and writing.  
 //	To open a file:
-//	  Find the location of the file's header, using the directory 
+//	  Find the location of the file's header, using the directories
+//	  along its path (or the dentry cache, if we have been there)
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path name of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(char *name)
 { 
-    Directory *directory = new Directory(NumDirEntries);
     OpenFile *openFile = NULL;
     int sector;
+    bool isDir;
 
     DEBUG('f', "Opening file %s\n", name);
-    //directory->FetchFrom(directoryFile);
-    directory->FetchFrom(curDirectoryFile);
-    sector = directory->Find(name); 
+    dirLock->AcquireRead();		// other Opens may go on at once
+    sector = Lookup(name, &isDir);
     if (sector >= 0) 		
 	openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
+    dirLock->ReleaseRead();
     return openFile;				// return NULL if not found
 }
 
+//----------------------------------------------------------------------
+// FileSystem::Lookup
+// 	Return the header sector of the file named by "path", or -1 if
+//	there is no such file.  The path is a list of names separated by
+//	'/'; it starts at the root if it begins with '/', otherwise at
+//	the current directory.  "." and ".." mean what they do in UNIX.
+//	Every name but the last must be a directory.
+//
+//	Called with dirLock held.
+//
+//	"isDir" -- set to whether the file found is a directory
+//----------------------------------------------------------------------
+
+int
+FileSystem::Lookup(char *path, bool *isDir)
+{
+    char name[FileNameMaxLen + 1];
+    int sector = (path[0] == '/') ? DirectorySector : curDirSector;
+
+    *isDir = TRUE;
+    for (;;) {
+	int len = 0;
+
+	while (*path == '/')
+	    path++;
+	if (*path == '\0')
+	    return sector;
+	if (!*isDir)			// a name after a plain file
+	    return -1;
+	while (path[len] != '\0' && path[len] != '/')
+	    len++;
+	if (len > FileNameMaxLen)
+	    return -1;
+	strncpy(name, path, len);
+	name[len] = '\0';
+	path += len;
+	if (strcmp(name, ".") != 0) {
+	    sector = LookupName(sector, name, isDir);
+	    if (sector == -1)
+		return -1;
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// FileSystem::LookupName
+// 	Return the header sector of "name" in the directory whose header
+//	is at "dir", or -1 if it isn't there.  Ask the dentry cache
+//	first; only if it doesn't know, read the directory, and tell the
+//	cache the answer (even if it is "no such file").
+//
+//	"isDir" -- set to whether the file found is a directory
+//----------------------------------------------------------------------
+
+int
+FileSystem::LookupName(int dir, char *name, bool *isDir)
+{
+    int sector;
+    OpenFile *file;
+    Directory *directory;
+
+    if (dcache->Lookup(dir, name, &sector, isDir))
+	return sector;
+
+    file = (dir == curDirSector) ? curDirectoryFile : new OpenFile(dir);
+    directory = new Directory(0);
+    directory->FetchFrom(file);
+    *isDir = FALSE;
+    if (!strcmp(name, "..")) {
+	sector = directory->GetParent();
+	*isDir = TRUE;
+    } else
+	sector = directory->Find(name, isDir);
+    delete directory;
+    if (file != curDirectoryFile)
+	delete file;
+
+    dcache->Enter(dir, name, sector, *isDir);
+    return sector;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Remove
 // 	Delete a file from the file system.  This requires:
@@ -396,7 +472,8 @@ FileSystem::Open(char *name)
 //	    Write changes to directory, bitmap back to disk
 //
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system.  Like Create, Remove works only on names in
+//	the current directory: a name with a '/' in it isn't found.
 //
 //	"name" -- the text name of the file to be removed
 //----------------------------------------------------------------------
@@ -405,46 +482,54 @@ bool
 FileSystem::Remove(char *name)
 { 
     Directory *directory;
-    BitMap *freeMap;
     FileHeader *fileHdr;
     int sector;
     
+    if (strchr(name, '/') != NULL)
+        return FALSE;			// not a name in this directory
+    dirLock->AcquireWrite();
     directory = new Directory(NumDirEntries);
     //directory->FetchFrom(directoryFile);
     directory->FetchFrom(curDirectoryFile);
     sector = directory->Find(name);
     if (sector == -1) {
        delete directory;
+       dirLock->ReleaseWrite();
        return FALSE;			 // file not found 
     }
     
-    if(synchDisk->openCnt[sector] > 0){
+    int refs = inodeTable->RefCount(sector);
+    if(refs > 0){
         printf("Cannot remove this file, %d openfiles still use it..\n",
-               synchDisk->openCnt[sector]);
+               refs);
+        delete directory;
+        dirLock->ReleaseWrite();
         return FALSE;
     }
-    
-    synchDisk->P(sector);
-    
-    fileHdr = new FileHeader;
-    fileHdr->FetchFrom(sector);
-
-    freeMap = new BitMap(NumSectors);
-    freeMap->FetchFrom(freeMapFile);
+    // nobody can open it now: Open needs the directory lock
+    fileHdr = inodeTable->Removed(sector);	// Sync mustn't write it back;
+    if (fileHdr == NULL) {			// a pinned header may be newer
+        fileHdr = new FileHeader;		// than the disk's
+        fileHdr->FetchFrom(sector);
+    }
 
+    freeMapLock->AcquireWrite();
     fileHdr->Deallocate(freeMap);  		// remove data blocks
     freeMap->Clear(sector);			// remove header block
     directory->Remove(name);
+    dcache->Enter(curDirSector, name, -1, FALSE);	// it's gone
+    dcache->Invalidate(sector);		// and so is anything in it,
+					// or any ".." that led to it
 
     freeMap->WriteBack(freeMapFile);		// flush to disk
+    freeMapLock->ReleaseWrite();
     //directory->WriteBack(directoryFile);        // flush to disk
     directory->WriteBack(curDirectoryFile);
     
-    synchDisk->V(sector);
+    dirLock->ReleaseWrite();
     
     delete fileHdr;
     delete directory;
-    delete freeMap;
     return TRUE;
 } 
 
@@ -458,8 +543,10 @@ FileSystem::List()
 {
     Directory *directory = new Directory(NumDirEntries);
 
+    dirLock->AcquireRead();
     directory->FetchFrom(directoryFile);
     directory->List();
+    dirLock->ReleaseRead();
     delete directory;
 }
 
@@ -481,7 +568,6 @@ FileSystem::Print()
     FileHeader *namHdr = new FileHeader;
     FileHeader *curHdr = new FileHeader;
     FileHeader *pipHdr = new FileHeader;
-    BitMap *freeMap = new BitMap(NumSectors);
     Directory *directory = new Directory(NumDirEntries);
 
     printf("Bit map file header:\n");
@@ -504,47 +590,42 @@ FileSystem::Print()
     curHdr->FetchFrom(CurDirecSector);
     curHdr->Print();
 
-    freeMap->FetchFrom(freeMapFile);
+    freeMapLock->AcquireRead();
     freeMap->Print();
+    freeMapLock->ReleaseRead();
     printf("\n");
 
+    dirLock->AcquireRead();
     //directory->FetchFrom(directoryFile);
     directory->FetchFrom(curDirectoryFile);
     directory->Print();
+    dirLock->ReleaseRead();
 
     delete bitHdr;
     delete dirHdr;
     delete namHdr;
-    delete freeMap;
     delete directory;
 } 
 
 void
 FileSystem::Change(char *name){
-    Directory *directory;
     int sector;
+    bool isDir;
     FileHeader *curHdr = new FileHeader;
     curHdr->FetchFrom(3);
     
-    directory = new Directory(NumDirEntries);
-    //directory->FetchFrom(directoryFile);
-    directory->FetchFrom(curDirectoryFile);
-    
-    int oriSector = curHdr->hdr_sector;
-    OpenFile *ddd = new OpenFile(oriSector);
-    directory->WriteBack(ddd);
+    dirLock->AcquireWrite();
+    sector = Lookup(name, &isDir);	// any path, through the cache
     
-    if(!strcmp(name, ".."))
-        sector = directory->table[0].sector;
-    else
-        sector = directory->Find(name);
-    
-    OpenFile *dd = new OpenFile(sector);
-    
-    directory->FetchFrom(dd);
-    directory->WriteBack(curDirectoryFile);
-    curHdr->hdr_sector = sector;
-    curHdr->WriteBack(3);
+    if(sector != -1 && isDir){
+        delete curDirectoryFile;	// it's the directory itself now,
+        curDirectoryFile = new OpenFile(sector);	// not a copy
+        curDirSector = sector;
+        curHdr->hdr_sector = sector;
+        curHdr->WriteBack(CurDirecSector);
+    }
+    delete curHdr;
+    dirLock->ReleaseWrite();
 }
 
 int FileSystem::ReadPipe(char *data){
@@ -65,6 +65,10 @@ class FileSystem {
 };
 
 #else // FILESYS
+class RWLock;
+class DentryCache;
+class FreeMap;
+
 class FileSystem {
   public:
     FileSystem(bool format);		// Initialize the file system.
@@ -88,17 +92,35 @@ class FileSystem {
 
     OpenFile* freeMapFile;		// Bit map of free disk blocks,
 					// represented as a file
+    FreeMap* freeMap;			// and kept in memory
     OpenFile* directoryFile;		// "Root" directory -- list of
 					// file names, represented as a file
     OpenFile* nameFile;
     
     OpenFile* curDirectoryFile;
+
+    RWLock* dirLock;			// readers: Open, List, Print;
+					// writers: anything that changes
+					// the directory
+    RWLock* freeMapLock;		// held for writing while "freeMap"
+					// is updated
     
     void Change(char *name);
     
     int ReadPipe(char *data);
     
     void WritePipe(char *data, int length);
+
+  private:
+    int Lookup(char *path, bool *isDir);
+					// Header sector of the file at "path",
+					// relative to the current directory
+					// unless it starts with '/'
+    int LookupName(int dir, char *name, bool *isDir);
+					// One component of a path
+
+    DentryCache *dcache;		// names already looked up
+    int curDirSector;			// header of the current directory
 };
 
 #endif // FILESYS
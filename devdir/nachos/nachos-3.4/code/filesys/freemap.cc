@@ -0,0 +1,200 @@
+// freemap.cc
+//	Routines to manage the file system's map of free sectors.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "freemap.h"
+
+//----------------------------------------------------------------------
+// FreeMap::FreeMap
+// 	Initialize a map of "nitems" sectors, all free.  The whole map
+//	is dirty, so that the first WriteBack writes all of it; that is
+//	what formatting the disk wants.
+//----------------------------------------------------------------------
+
+FreeMap::FreeMap(int nitems) : BitMap(nitems)
+{
+    numGroups = divRoundUp(numBits, SectorsPerGroup);
+    groupFree = new int[numGroups];
+    for (int g = 0; g < numGroups; g++)
+	groupFree[g] = min(SectorsPerGroup, numBits - g * SectorsPerGroup);
+
+    numSectors = divRoundUp(numWords * sizeof(unsigned int), SectorSize);
+    dirty = new bool[numSectors];
+    for (int s = 0; s < numSectors; s++)
+	dirty[s] = TRUE;
+
+    logging = FALSE;
+    undoSize = 16;
+    undoLog = new int[undoSize];
+    undoCount = 0;
+}
+
+FreeMap::~FreeMap()
+{
+    delete [] groupFree;
+    delete [] dirty;
+    delete [] undoLog;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::Changed
+// 	Bit "which" has just been set (or cleared, if "set" is FALSE):
+//	update its group's count, remember that its sector of the map
+//	must be written back, and, after Begin, how to undo it.
+//----------------------------------------------------------------------
+
+void
+FreeMap::Changed(int which, bool set)
+{
+    groupFree[which / SectorsPerGroup] += set ? -1 : 1;
+    dirty[which / BitsPerSector] = TRUE;
+    if (!logging)
+	return;
+    if (undoCount == undoSize) {		// double the log
+	int *bigger = new int[2 * undoSize];
+
+	bcopy(undoLog, bigger, undoSize * sizeof(int));
+	delete [] undoLog;
+	undoLog = bigger;
+	undoSize *= 2;
+    }
+    undoLog[undoCount++] = set ? which : -1 - which;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::Mark/Clear
+// 	Allocate or free sector "which".  Only a bit that actually
+//	changes is counted.
+//----------------------------------------------------------------------
+
+void
+FreeMap::Mark(int which)
+{
+    if (Test(which))
+	return;
+    BitMap::Mark(which);
+    Changed(which, TRUE);
+}
+
+void
+FreeMap::Clear(int which)
+{
+    if (!Test(which))
+	return;
+    BitMap::Clear(which);
+    Changed(which, FALSE);
+}
+
+//----------------------------------------------------------------------
+// FreeMap::NumClear
+// 	Return the number of free sectors, by adding up the groups.
+//----------------------------------------------------------------------
+
+int
+FreeMap::NumClear()
+{
+    int count = 0;
+
+    for (int g = 0; g < numGroups; g++)
+	count += groupFree[g];
+    return count;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::NextClear
+// 	Return the first free sector at or after "from", or -1 if there
+//	is none.  Groups with nothing free are skipped by their counts;
+//	from the first group that has something, BitMap::NextClear
+//	skips full words.
+//----------------------------------------------------------------------
+
+int
+FreeMap::NextClear(int from)
+{
+    for (int g = from / SectorsPerGroup; g < numGroups; g++)
+	if (groupFree[g] > 0)
+	    return BitMap::NextClear(max(from, g * SectorsPerGroup));
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::FetchFrom
+// 	Read the whole map from "file", and count the free sectors in
+//	each group.  Nothing is dirty afterwards.
+//----------------------------------------------------------------------
+
+void
+FreeMap::FetchFrom(OpenFile *file)
+{
+    BitMap::FetchFrom(file);
+    for (int g = 0; g < numGroups; g++) {
+	int last = min((g + 1) * SectorsPerGroup, numBits);
+
+	groupFree[g] = 0;
+	for (int i = BitMap::NextClear(g * SectorsPerGroup);
+	     i != -1 && i < last; i = BitMap::NextClear(i + 1))
+	    groupFree[g]++;
+    }
+    for (int s = 0; s < numSectors; s++)
+	dirty[s] = FALSE;
+}
+
+//----------------------------------------------------------------------
+// FreeMap::WriteBack
+// 	Write the sectors of the map that changed back to "file".
+//----------------------------------------------------------------------
+
+void
+FreeMap::WriteBack(OpenFile *file)
+{
+    int mapBytes = numWords * sizeof(unsigned int);
+
+    for (int s = 0; s < numSectors; s++)
+	if (dirty[s]) {
+	    file->WriteAt((char *) map + s * SectorSize,
+			  min(SectorSize, mapBytes - s * SectorSize),
+			  s * SectorSize);
+	    dirty[s] = FALSE;
+	}
+}
+
+//----------------------------------------------------------------------
+// FreeMap::Begin/Commit/Abort
+// 	Begin starts logging changes.  Commit writes them back to "file"
+//	and forgets them; Abort undoes them, latest first.
+//----------------------------------------------------------------------
+
+void
+FreeMap::Begin()
+{
+    ASSERT(!logging);
+    logging = TRUE;
+    undoCount = 0;
+}
+
+void
+FreeMap::Commit(OpenFile *file)
+{
+    ASSERT(logging);
+    logging = FALSE;
+    WriteBack(file);
+}
+
+void
+FreeMap::Abort()
+{
+    ASSERT(logging);
+    logging = FALSE;
+    while (undoCount > 0) {
+	int which = undoLog[--undoCount];
+
+	if (which >= 0)
+	    Clear(which);
+	else
+	    Mark(-1 - which);
+    }
+}
@@ -0,0 +1,67 @@
+// freemap.h
+//	Data structures for the file system's map of free sectors.
+//
+//	The map used to be read from the free map file, changed, and
+//	written back whole, by every operation that allocated or freed a
+//	sector.  Instead, the file system keeps one FreeMap in memory
+//	for as long as it runs; it is read once, and only the sectors of
+//	the map file whose bits changed are written back.
+//
+//	The map is divided into groups of SectorsPerGroup bits, and keeps
+//	a count of the free sectors in each, so that a search skips full
+//	groups without looking at their bits.
+//
+//	Create allocates several things, any of which may fail; Begin
+//	starts remembering changes, so that Abort can undo them all,
+//	and Commit writes them back.
+//
+//	The caller provides mutual exclusion (FileSystem::freeMapLock).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FREEMAP_H
+#define FREEMAP_H
+
+#include "copyright.h"
+#include "bitmap.h"
+#include "disk.h"
+
+#define SectorsPerGroup	(4 * SectorsPerTrack)	// a multiple of BitsInWord
+#define BitsPerSector	(SectorSize * BitsInByte)
+
+class FreeMap : public BitMap {
+  public:
+    FreeMap(int nitems);		// Initialize a map with every sector
+					// free, all of it to be written
+    ~FreeMap();
+
+    void Mark(int which);		// Allocate/free a sector,
+    void Clear(int which);		// keeping the counts up to date
+    int NumClear();			// Free sectors, from the counts
+
+    void FetchFrom(OpenFile *file);	// Read the whole map in
+    void WriteBack(OpenFile *file);	// Write back the changed sectors
+
+    void Begin();			// Remember changes from now on
+    void Commit(OpenFile *file);	// Keep them, and write them back
+    void Abort();			// Undo them
+
+  protected:
+    int NextClear(int from);		// Skips full groups
+
+  private:
+    void Changed(int which, bool set);	// Account for a bit that changed
+
+    int numGroups;
+    int *groupFree;			// free sectors in each group
+    int numSectors;			// sectors of the map file
+    bool *dirty;			// which of them must be written back
+    bool logging;			// between Begin and Commit/Abort?
+    int *undoLog;			// changes since Begin: "which" for
+					// a Mark, -1 - "which" for a Clear
+    int undoCount, undoSize;
+};
+
+#endif // FREEMAP_H
@@ -7,6 +7,8 @@
 //	   Perftest -- a stress test for the Nachos file system
 //		read and write a really large file in tiny chunks
 //		(won't work on baseline system!)
+//	   DiskSchedTest -- several threads reading files far apart on
+//		the disk at once, to measure the disk scheduler
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -187,6 +189,87 @@ PerformanceTest()
     stats->Print();
 }
 
+//----------------------------------------------------------------------
+// DiskSchedTest
+// 	Measure how much the disk head has to move when several threads
+//	use the disk at once.  Each of DSThreads threads reads its own
+//	file, a few tracks long, a sector at a time; the files are laid
+//	out one after another, so the threads' requests are tracks apart.
+//
+//	Prints the ticks taken, and how many of them the disk spent
+//	seeking.  Run it with "-ds fifo", "-ds sstf" and "-ds cscan" to
+//	compare the scheduling policies; "-cb" with a small cache makes
+//	more of the reads go to the disk.
+//----------------------------------------------------------------------
+
+#define DSThreads	4
+#define DSFileSize	(3 * SectorsPerTrack * SectorSize)
+
+static Semaphore *dsDone;
+
+static void
+DSReader(int which)
+{
+    char name[16], buffer[SectorSize];
+    OpenFile *openFile;
+
+    sprintf(name, "dsfile%d", which);
+    if ((openFile = fileSystem->Open(name)) == NULL) {
+	printf("Disk sched test: unable to open %s\n", name);
+    } else {
+	for (int i = 0; i < DSFileSize; i += SectorSize)
+	    if (openFile->Read(buffer, SectorSize) < SectorSize) {
+		printf("Disk sched test: unable to read %s\n", name);
+		break;
+	    }
+	delete openFile;
+    }
+    dsDone->V();
+}
+
+void
+DiskSchedTest()
+{
+    char name[16], buffer[SectorSize];
+    OpenFile *openFile;
+    int i, startTicks, startSeek;
+
+    printf("Starting disk scheduling test: %d threads, %d byte files\n",
+	   DSThreads, DSFileSize);
+    memset(buffer, 'x', SectorSize);
+    for (i = 0; i < DSThreads; i++) {
+	sprintf(name, "dsfile%d", i);
+	if (!fileSystem->Create(name, DSFileSize)
+		|| (openFile = fileSystem->Open(name)) == NULL) {
+	    printf("Disk sched test: can't create %s\n", name);
+	    return;
+	}
+	for (int j = 0; j < DSFileSize; j += SectorSize)
+	    openFile->Write(buffer, SectorSize);
+	delete openFile;
+    }
+    synchDisk->Flush();			// start with nothing to write
+
+    dsDone = new Semaphore("disk sched test", 0);
+    startTicks = stats->totalTicks;
+    startSeek = stats->diskSeekTicks;
+    for (i = 0; i < DSThreads; i++) {
+	Thread *t = new Thread("disk sched reader");
+
+	t->Fork(DSReader, i);
+    }
+    for (i = 0; i < DSThreads; i++)
+	dsDone->P();
+    printf("Disk sched test: %d ticks, %d of them seeking\n",
+	   stats->totalTicks - startTicks, stats->diskSeekTicks - startSeek);
+    delete dsDone;
+
+    for (i = 0; i < DSThreads; i++) {
+	sprintf(name, "dsfile%d", i);
+	fileSystem->Remove(name);
+    }
+}
+
 void OpenFileTest(){
     OpenFile *openFile1;
     OpenFile *openFile2;
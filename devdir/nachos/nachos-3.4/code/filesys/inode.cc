@@ -0,0 +1,270 @@
+// inode.cc
+//	Routines to manage the table of in-core file headers.
+//
+//	The table lock is held while a header is read in or written back,
+//	so that two threads opening the same file can't both read it;
+//	opens of different files wait for each other only that long.
+//
+//	An inode's own lock is never waited for with the table lock held,
+//	so that a thread holding an inode lock is free to open or close
+//	other files, which takes the table lock.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "inode.h"
+#include "filehdr.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// InodeTable::InodeTable
+// 	Initialize an empty inode table.
+//----------------------------------------------------------------------
+
+InodeTable::InodeTable()
+{
+    for (int i = 0; i < InodeHashSize; i++)
+	hashTable[i] = NULL;
+    lock = new Lock("inode table");
+}
+
+//----------------------------------------------------------------------
+// InodeTable::~InodeTable
+// 	De-allocate the table, and any inodes still in it.  Their headers
+//	were written back by Sync, from Interrupt::Halt.
+//----------------------------------------------------------------------
+
+InodeTable::~InodeTable()
+{
+    for (int i = 0; i < InodeHashSize; i++)
+	while (hashTable[i] != NULL) {
+	    Inode *inode = hashTable[i];
+
+	    hashTable[i] = inode->hashNext;
+	    delete inode->hdr;
+	    delete inode->lock;
+	    delete inode;
+	}
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Find
+// 	Return the inode for the header at "sector", or NULL if the file
+//	isn't in use.  Called with the table lock held.
+//----------------------------------------------------------------------
+
+Inode *
+InodeTable::Find(int sector)
+{
+    Inode *inode;
+
+    for (inode = hashTable[sector % InodeHashSize]; inode != NULL;
+	 inode = inode->hashNext)
+	if (inode->sector == sector)
+	    break;
+    return inode;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Get
+// 	Return the inode for the file whose header is at "sector", with
+//	one more reference counted.  If nobody has the file open, read
+//	its header in.
+//----------------------------------------------------------------------
+
+Inode *
+InodeTable::Get(int sector)
+{
+    Inode *inode;
+
+    lock->Acquire();
+    inode = Find(sector);
+    if (inode == NULL) {
+	inode = new Inode;
+	inode->sector = sector;
+	inode->refCount = 0;
+	inode->pins = 0;
+	inode->hdr = new FileHeader;
+	inode->hdr->FetchFrom(sector);
+	inode->lock = new Lock("inode");
+	inode->dirty = FALSE;
+	inode->removed = FALSE;
+	inode->hashNext = hashTable[sector % InodeHashSize];
+	hashTable[sector % InodeHashSize] = inode;
+    }
+    inode->refCount++;
+    lock->Release();
+    return inode;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Put
+// 	Drop a reference to "inode".  If it was the last, write the
+//	header back if it changed, and free the inode.
+//----------------------------------------------------------------------
+
+void
+InodeTable::Put(Inode *inode)
+{
+    lock->Acquire();
+    ASSERT(inode->refCount > 0);
+    inode->refCount--;
+    Drop(inode);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Unhash
+// 	Take "inode" out of its bucket.  Called with the table lock held.
+//----------------------------------------------------------------------
+
+void
+InodeTable::Unhash(Inode *inode)
+{
+    Inode **ptr = &hashTable[inode->sector % InodeHashSize];
+
+    while (*ptr != inode)
+	ptr = &(*ptr)->hashNext;
+    *ptr = inode->hashNext;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Drop
+// 	If nobody uses "inode" any more, write its header back if it
+//	changed (unless the file was removed), and free it.  Called with
+//	the table lock held.
+//----------------------------------------------------------------------
+
+void
+InodeTable::Drop(Inode *inode)
+{
+    if (inode->refCount > 0)
+	return;
+    if (!inode->removed) {
+	Unhash(inode);
+	if (inode->dirty)		// nobody else can have it locked
+	    inode->hdr->WriteBack(inode->sector);
+    }
+    delete inode->hdr;
+    delete inode->lock;
+    delete inode;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::RefCount
+// 	Return how many references there are to the file whose header
+//	is at "sector"; 0 if it isn't open.  The pins Sync holds while
+//	it writes headers back aren't counted, so that they don't make
+//	FileSystem::Remove fail.
+//----------------------------------------------------------------------
+
+int
+InodeTable::RefCount(int sector)
+{
+    Inode *inode;
+    int count;
+
+    lock->Acquire();
+    inode = Find(sector);
+    count = (inode != NULL) ? inode->refCount - inode->pins : 0;
+    lock->Release();
+    return count;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Removed
+// 	The file whose header is at "sector" has been removed, while
+//	nothing but Sync may still have its inode pinned.  Take the inode
+//	out of the table, so that a new file with its header in the same
+//	sector gets a fresh one, and make sure the old header is never
+//	written back over whatever is allocated there next.
+//
+//	A write back by Sync may already be under way; wait for it, by
+//	way of the inode's lock, before the caller frees the sectors.
+//
+//	The in-core header may be newer than the one on disk (an extend
+//	that was never written back), so it is handed to the caller, who
+//	deallocates from it and deletes it.  Return NULL if the file had
+//	no inode; the header on disk is then up to date.
+//----------------------------------------------------------------------
+
+FileHeader *
+InodeTable::Removed(int sector)
+{
+    Inode *inode;
+    FileHeader *hdr;
+
+    lock->Acquire();
+    inode = Find(sector);
+    if (inode == NULL) {
+	lock->Release();
+	return NULL;
+    }
+    ASSERT(inode->refCount == inode->pins);
+    Unhash(inode);
+    inode->removed = TRUE;
+    inode->refCount++;			// keep it while we wait
+    lock->Release();
+
+    inode->lock->Acquire();
+    hdr = inode->hdr;			// Drop mustn't delete it now
+    inode->hdr = NULL;
+    inode->lock->Release();
+    Put(inode);
+    return hdr;
+}
+
+//----------------------------------------------------------------------
+// InodeTable::Sync
+// 	Write back the header of every dirty inode.  The dirty inodes are
+//	picked out, and held by an extra reference (a "pin", which
+//	RefCount doesn't count), with the table lock held; each is then
+//	locked, and written back, without it.  A file removed meanwhile
+//	is skipped.
+//----------------------------------------------------------------------
+
+void
+InodeTable::Sync()
+{
+    Inode **dirty;
+    int i, numDirty = 0;
+
+    lock->Acquire();
+    for (i = 0; i < InodeHashSize; i++)
+	for (Inode *inode = hashTable[i]; inode != NULL; inode = inode->hashNext)
+	    if (inode->dirty)
+		numDirty++;
+    if (numDirty == 0) {
+	lock->Release();
+	return;
+    }
+    dirty = new Inode *[numDirty];
+    numDirty = 0;
+    for (i = 0; i < InodeHashSize; i++)
+	for (Inode *inode = hashTable[i]; inode != NULL; inode = inode->hashNext)
+	    if (inode->dirty) {
+		inode->refCount++;
+		inode->pins++;
+		dirty[numDirty++] = inode;
+	    }
+    lock->Release();
+
+    for (i = 0; i < numDirty; i++) {
+	dirty[i]->lock->Acquire();
+	if (dirty[i]->dirty && !dirty[i]->removed) {
+	    dirty[i]->hdr->WriteBack(dirty[i]->sector);
+	    dirty[i]->dirty = FALSE;
+	}
+	dirty[i]->lock->Release();
+
+	lock->Acquire();		// unpin, and drop the reference
+	dirty[i]->pins--;
+	dirty[i]->refCount--;
+	Drop(dirty[i]);
+	lock->Release();
+    }
+    delete [] dirty;
+}
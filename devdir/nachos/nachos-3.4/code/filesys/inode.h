@@ -0,0 +1,80 @@
+// inode.h
+//	Data structures for the table of in-core file headers.
+//
+//	Every OpenFile used to read its own copy of the file header, so
+//	two opens of the same file each paid for the read, and an
+//	extension made through one was invisible to the other.  Instead,
+//	the inode table keeps one in-core "inode" per open file, found by
+//	the sector its header is in.  Opening a file that is already open
+//	just counts another reference; the last close lets it go.
+//
+//	Each inode has a lock, which ReadAt and WriteAt hold while they use
+//	the header.  A change to the header only marks the inode dirty; it
+//	is written back when the last reference goes away, or when the
+//	disk flusher runs (Sync), or at Halt.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef INODE_H
+#define INODE_H
+
+#include "copyright.h"
+#include "synch.h"
+
+class FileHeader;
+
+#define InodeHashSize	31		// buckets in the inode table
+
+// One open file's header.
+
+class Inode {
+  public:
+    int sector;				// where the header is on disk
+    int refCount;			// OpenFiles (and others) using it
+    int pins;				// of those, Sync's, which don't keep
+					// the file from being removed
+    FileHeader *hdr;			// the header, shared by all of them
+    Lock *lock;				// held while "hdr" is used
+    bool dirty;				// "hdr" changed since it was read
+					// or written back
+    bool removed;			// the file is gone: never write
+					// "hdr" back; no longer in the table
+    Inode *hashNext;			// next inode in the same bucket
+
+    void MarkDirty() { dirty = TRUE; }	// Called with "lock" held
+};
+
+// The table of all inodes in use.
+
+class InodeTable {
+  public:
+    InodeTable();			// Initialize an empty table
+    ~InodeTable();
+
+    Inode *Get(int sector);		// Return the inode for the header
+					// at "sector", reading it in if it
+					// isn't in use, and count a reference
+    void Put(Inode *inode);		// Drop a reference; the last one
+					// writes the header back if dirty
+    int RefCount(int sector);		// References to the file whose
+					// header is at "sector", 0 if none;
+					// Sync's pins aren't counted
+    FileHeader *Removed(int sector);	// The file at "sector" was removed:
+					// let go of its inode, unwritten,
+					// and return its in-core header
+					// (NULL if it wasn't in the table)
+    void Sync();			// Write back every dirty header
+
+  private:
+    Inode *Find(int sector);		// Inode for "sector", or NULL
+    void Unhash(Inode *inode);		// Take "inode" out of the table
+    void Drop(Inode *inode);		// Free "inode" if nobody uses it
+
+    Inode *hashTable[InodeHashSize];	// inodes in use, by sector
+    Lock *lock;				// protects the table and the
+					// reference counts
+};
+
+#endif // INODE_H
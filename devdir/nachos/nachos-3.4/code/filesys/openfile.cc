@@ -5,7 +5,8 @@
 //	the OpenFile data structure).
 //
 //	Also as in UNIX, for convenience, we keep the file header in
-//	memory while the file is open.
+//	memory while the file is open.  It is kept in the inode table,
+//	so every OpenFile for the same file uses the same copy.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -14,6 +15,8 @@
 #include "copyright.h"
 #include "filehdr.h"
 #include "openfile.h"
+#include "inode.h"
+#include "freemap.h"
 #include "system.h"
 #ifdef HOST_SPARC
 #include <strings.h>
@@ -22,29 +25,31 @@
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open, unless it is already there
+//	because the file is open elsewhere.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 { 
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    inode = inodeTable->Get(sector);
+    hdr = inode->hdr;
     seekPosition = 0;
-    hdrSector = sector;
-    synchDisk->openCnt[sector]++;
+    nextRead = 0;
+    raWindow = 0;
+    raLimit = 0;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
 // 	Close a Nachos file, de-allocating any in-memory data structures.
+//	The header is written back, if need be, by the last close.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
-    synchDisk->openCnt[hdrSector]--;
+    inodeTable->Put(inode);
 }
 
 //----------------------------------------------------------------------
@@ -158,14 +163,16 @@ OpenFile::oldReadAt(char *into, int numBytes, int position)
 int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
-    synchDisk->P(hdrSector);
+    inode->lock->Acquire();
     
     int fileLength = hdr->FileLength();
     int i, firstSector, lastSector, numSectors;
     char *buf;
     
-    if ((numBytes <= 0) || (position >= fileLength))
+    if ((numBytes <= 0) || (position >= fileLength)) {
+        inode->lock->Release();
         return 0;                 // check request
+    }
     if ((position + numBytes) > fileLength)
         numBytes = fileLength - position;
     DEBUG('f', "Reading %d bytes at %d, from file of length %d.\n",
@@ -175,6 +182,8 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
     numSectors = 1 + lastSector - firstSector;
     
+    ReadAhead(position, numBytes);
+    
     // read in all the full and partial sectors that we need
     buf = new char[numSectors * SectorSize];
     for (i = firstSector; i <= lastSector; i++)
@@ -190,7 +199,7 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
     
     delete [] buf;
     
-    synchDisk->V(hdrSector);
+    inode->lock->Release();
     
     return numBytes;
     
@@ -202,26 +211,45 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
 int
 OpenFile::WriteAt(char *from, int numBytes, int position)
 {
-    synchDisk->P(hdrSector);
+    inode->lock->Acquire();
     
     int fileLength = hdr->FileLength();
     int i, firstSector, lastSector, numSectors;
     bool firstAligned, lastAligned;
     char *buf;
 
-    if ((numBytes <= 0))
-    return 0;                // check request
+    if ((numBytes <= 0)) {
+        inode->lock->Release();
+        return 0;                // check request
+    }
     //if ((position + numBytes) > fileLength)
 	//numBytes = fileLength - position;
     
     if(position + numBytes > fileLength){
-        OpenFile* freeMapFile = new OpenFile(0);
-        BitMap* freeMap = new BitMap(NumSectors);
-        freeMap->FetchFrom(freeMapFile);
-        hdr->Extend(freeMap, position+numBytes-fileLength);
-        hdr->WriteBack(hdrSector);
-        freeMap->WriteBack(freeMapFile);
-        delete freeMapFile;
+        // nothing grows while the disk is being formatted, when
+        // fileSystem is still NULL; Create and CreateDir already hold
+        // the lock when they grow a directory, and write the bitmap
+        // back themselves
+        ASSERT(fileSystem != NULL);
+        RWLock* mapLock = fileSystem->freeMapLock;
+        bool held = mapLock->isWriteHeldByCurrentThread();
+        if(!held)
+            mapLock->AcquireWrite();
+        bool grown = hdr->Extend(fileSystem->freeMap,
+                                 position+numBytes-fileLength);
+        if(!held){
+            fileSystem->freeMap->WriteBack(fileSystem->freeMapFile);
+            mapLock->ReleaseWrite();
+        }
+        if(grown)
+            inode->MarkDirty();		// the header goes lazily
+        else{				// disk full: write what fits
+            numBytes = fileLength - position;
+            if(numBytes <= 0){
+                inode->lock->Release();
+                return 0;
+            }
+        }
     }
     
     DEBUG('f', "Writing %d bytes at %d, from file of length %d.\n", 	
@@ -255,10 +283,11 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
      time(&timep);
      hdr->setLastVisitTime(asctime(gmtime((&timep))));
      hdr->setLastModifyTime(asctime(gmtime((&timep))));
+     inode->MarkDirty();
     
     delete [] buf;
     
-    synchDisk->V(hdrSector);
+    inode->lock->Release();
     
     return numBytes;
     
@@ -268,6 +297,47 @@ OpenFile::WriteAt(char *from, int numBytes, int position)
     hdr->setLastModifyTime(asctime(gmtime((&timep))));*/
 }
 
+//----------------------------------------------------------------------
+// OpenFile::ReadAhead
+// 	Called by ReadAt for each read, before it waits for the sectors.
+//	If the read starts where the last one ended, the file is being
+//	read sequentially: ask the disk to start on the next "raWindow"
+//	sectors after this read, doubling the window each time (up to
+//	MaxReadAhead) so that a long stream keeps further ahead of the
+//	reader.  Any other read closes the window again.
+//
+//	Sectors already asked for (below "raLimit") aren't asked for
+//	again, so small reads within a sector cost nothing extra.
+//
+//	"position", "numBytes" -- the part of the file being read
+//----------------------------------------------------------------------
+
+void
+OpenFile::ReadAhead(int position, int numBytes)
+{
+    int lastSector = divRoundDown(position + numBytes - 1, SectorSize);
+    int fileSectors = divRoundUp(hdr->FileLength(), SectorSize);
+
+    if (position != nextRead)
+        raWindow = 0;
+    else if (raWindow == 0)
+        raWindow = MinReadAhead;
+    else if (lastSector >= raLimit - raWindow / 2 && raWindow < MaxReadAhead)
+        raWindow *= 2;			// reader is catching up
+    nextRead = position + numBytes;
+    if (raWindow == 0) {
+        raLimit = 0;
+        return;
+    }
+
+    int first = max(lastSector + 1, raLimit);
+    int last = min(lastSector + raWindow, fileSectors - 1);
+    for (int i = first; i <= last; i++)
+        synchDisk->ReadAhead(hdr->ByteToSector(i * SectorSize));
+    if (last >= first)
+        raLimit = last + 1;
+}
+
 //----------------------------------------------------------------------
 // OpenFile::Length
 // 	Return the number of bytes in the file.
@@ -52,6 +52,8 @@ class OpenFile {
 		}
 
     int Length() { Lseek(file, 0, 2); return Tell(file); }
+    int getPosition() { return currentOffset; }
+    void setPosition(int t) { currentOffset = t; }
     
   private:
     int file;
@@ -60,6 +62,11 @@ class OpenFile {
 
 #else // FILESYS
 class FileHeader;
+class Inode;
+
+#define MinReadAhead	2		// sectors read ahead once a file
+					// is seen to be read sequentially
+#define MaxReadAhead	16		// the window doubles up to this
 
 class OpenFile {
   public:
@@ -90,12 +97,20 @@ class OpenFile {
     int getPosition(){return seekPosition;}
     void setPosition(int t){seekPosition = t;}
     
-    FileHeader *hdr;
+    FileHeader *hdr;			// Header for this file, shared
+					// with other opens of it
   
 private:
-    //FileHeader *hdr;			// Header for this file
+    Inode *inode;			// where "hdr" comes from
     int seekPosition;			// Current position within the file
-    int hdrSector;
+
+    void ReadAhead(int position, int numBytes);
+					// Note a read, and ask for the
+					// sectors after it if sequential
+    int nextRead;			// where a sequential read would start
+    int raWindow;			// sectors to keep read ahead,
+					// 0 if access isn't sequential
+    int raLimit;			// first sector not yet read ahead
 };
 
 #endif // FILESYS
@@ -5,10 +5,17 @@
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	The physical disk can only handle one operation at a time, so
+//	requests wait in a queue; each has a semaphore, V'd by the
+//	interrupt handler when the request is done.  The handler also
+//	starts the next request, chosen by the scheduling policy, so the
+//	disk never sits idle while there is work for it.
+//
+//	Above that sits a buffer cache of recently used sectors.  While
+//	a buffer is being read or written it is marked busy, and its
+//	sector is in the hash table, so that a second thread wanting the
+//	same sector waits for the first transfer rather than starting
+//	its own.  "cacheLock" is never held across a disk transfer.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,6 +23,7 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // DiskRequestDone
@@ -31,48 +39,103 @@ DiskRequestDone (int arg)
     disk->RequestDone();
 }
 
+//----------------------------------------------------------------------
+// DiskFlushTimer, DiskFlusher, DiskReadAheader
+// 	Dummy functions because C++ can't indirectly invoke member
+//	functions.  The first is the interrupt handler that says it is
+//	time to write back dirty buffers; the second is the body of the
+//	flusher thread, which does it; the third is the body of the
+//	read-ahead thread.
+//----------------------------------------------------------------------
+
+static void
+DiskFlushTimer (int arg)
+{
+    SynchDisk* disk = (SynchDisk *)arg;
+
+    disk->FlushTimer();
+}
+
+static void
+DiskFlusher (int arg)
+{
+    SynchDisk* disk = (SynchDisk *)arg;
+
+    disk->Flusher();
+}
+
+static void
+DiskReadAheader (int arg)
+{
+    SynchDisk* disk = (SynchDisk *)arg;
+
+    disk->ReadAheader();
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
-//	initializing the physical disk.
+//	initializing the physical disk.  Start with an empty buffer
+//	cache, and fork the threads that write dirty buffers back and
+//	read sectors ahead.
 //
 //	"name" -- UNIX file name to be used as storage for the disk data
 //	   (usually, "DISK")
+//	"nBuffers" -- number of sectors to cache
+//	"diskPolicy" -- the order in which queued requests are done
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk(char* name)
+SynchDisk::SynchDisk(char* name, int nBuffers, DiskPolicy diskPolicy)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
     disk = new Disk(name, DiskRequestDone, (int) this);
+    policy = diskPolicy;
+    queue = active = NULL;
     
-    for(int i=0; i<NumSectors; ++i)
-        diskSem[i] = new Semaphore("sector semaphore", 1);
-    
-    for(int i=0; i<NumSectors; ++i)
-        openCnt[i] = 0;
-    
-    cache = new Cache;
+    ASSERT(nBuffers > 0);
+    numBuffers = nBuffers;
+    buffers = new Cache[numBuffers];
+    hashTable = new Cache *[numBuffers];
+    for (int i = 0; i < numBuffers; i++) {
+	hashTable[i] = NULL;
+	buffers[i].lruPrev = (i > 0) ? &buffers[i - 1] : NULL;
+	buffers[i].lruNext = (i < numBuffers - 1) ? &buffers[i + 1] : NULL;
+    }
+    mostRecent = &buffers[0];
+    leastRecent = &buffers[numBuffers - 1];
+    cacheLock = new Lock("buffer cache lock");
+    bufferReady = new Condition("buffer ready");
+    flushWanted = new Semaphore("flush wanted", 0);
+    flushScheduled = FALSE;
+
+    raHead = raCount = 0;
+    readAheadWanted = new Semaphore("read ahead wanted", 0);
+
+    Thread *flusher = new Thread("disk flusher");
+    flusher->Fork(DiskFlusher, (int) this);
+    Thread *reader = new Thread("disk read ahead");
+    reader->Fork(DiskReadAheader, (int) this);
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::~SynchDisk
 // 	De-allocate data structures needed for the synchronous disk
-//	abstraction.
+//	abstraction.  Anything still dirty was written back by Flush,
+//	from Interrupt::Halt.
 //----------------------------------------------------------------------
 
 SynchDisk::~SynchDisk()
 {
-    for(int i=0; i<NumSectors; ++i)
-        delete diskSem[i];
     delete disk;
-    delete lock;
-    delete semaphore;
-    delete cache;
+    delete [] buffers;
+    delete [] hashTable;
+    delete cacheLock;
+    delete bufferReady;
+    delete flushWanted;
+    delete readAheadWanted;
 }
 
 //----------------------------------------------------------------------
-// SynchDisk::ReadSector
+// SynchDisk::DiskRead
 // 	Read the contents of a disk sector into a buffer.  Return only
 //	after the data has been read.
 //
@@ -81,36 +144,16 @@ SynchDisk::~SynchDisk()
 //----------------------------------------------------------------------
 
 void
-SynchDisk::ReadSector(int sectorNumber, char* data)
+SynchDisk::DiskRead(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
-}
+    DiskRequest req(sectorNumber, data, FALSE);
 
-/*void SynchDisk::ReadSector(int sectorNumber, char* data){
-    if(cache->valid && cache->sector == sectorNumber){
-        //printf("cache hit!\n");
-        bcopy(cache->data, data, SectorSize);
-        return;
-    }
-    
-    //printf("cache miss!\n");
-    oldReadSector(sectorNumber, data);
-    if(cache->dirty){
-        oldWriteSector(cache->sector, cache->data);
-        cache->dirty = FALSE;
-    }
-    
-    cache->valid = TRUE;
-    cache->sector = sectorNumber;
-    bcopy(data, cache->data, SectorSize);
-    return;
-}*/
+    Submit(&req);
+    req.done->P();			// wait for interrupt
+}
 
 //----------------------------------------------------------------------
-// SynchDisk::WriteSector
+// SynchDisk::DiskWrite
 // 	Write the contents of a buffer into a disk sector.  Return only
 //	after the data has been written.
 //
@@ -118,53 +161,446 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 //	"data" -- the new contents of the disk sector
 //----------------------------------------------------------------------
 
+void
+SynchDisk::DiskWrite(int sectorNumber, char* data)
+{
+    DiskRequest req(sectorNumber, data, TRUE);
+
+    Submit(&req);
+    req.done->P();			// wait for interrupt
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Submit
+// 	Put a request on the queue, and start it if the disk is idle.
+//	Return at once; the request's semaphore is V'd when it is done.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Submit(DiskRequest *req)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    DiskRequest **ptr = &queue;
+
+    while (*ptr != NULL)		// keep the order they came in,
+	ptr = &(*ptr)->next;		// for DiskFIFO
+    req->next = NULL;
+    *ptr = req;
+    if (active == NULL)
+	StartNext();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartNext
+// 	Send the disk the next request from the queue, if there is one.
+//	Called with interrupts off, from Submit or the interrupt handler.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartNext()
+{
+    active = PickNext();
+    if (active == NULL)
+	return;
+    if (active->writing)
+	disk->WriteRequest(active->sector, active->data);
+    else
+	disk->ReadRequest(active->sector, active->data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::PickNext
+// 	Take the request that should go next off the queue, and return
+//	it; NULL if the queue is empty.  See synchdisk.h for the policies.
+//
+//	For DiskCSCAN, a request's distance is the number of tracks the
+//	head must sweep upward to get to it, wrapping around from the
+//	last track to the first; ties (requests on the same track) go
+//	to the one that will take least time.
+//----------------------------------------------------------------------
+
+DiskRequest *
+SynchDisk::PickNext()
+{
+    DiskRequest **best = NULL;
+    int bestTracks = 0, bestTime = 0;
+    int headTrack = disk->HeadSector() / SectorsPerTrack;
+
+    if (queue == NULL)
+	return NULL;
+    if (policy == DiskFIFO)
+	best = &queue;
+    else
+	for (DiskRequest **ptr = &queue; *ptr != NULL; ptr = &(*ptr)->next) {
+	    DiskRequest *req = *ptr;
+	    int tracks = 0;
+	    int time = disk->ComputeLatency(req->sector, req->writing);
+
+	    if (policy == DiskCSCAN)
+		tracks = (req->sector / SectorsPerTrack - headTrack
+			  + NumTracks) % NumTracks;
+	    if (best == NULL || tracks < bestTracks
+		    || (tracks == bestTracks && time < bestTime)) {
+		best = ptr;
+		bestTracks = tracks;
+		bestTime = time;
+	    }
+	}
+
+    DiskRequest *req = *best;
+    *best = req->next;
+    req->next = NULL;
+    return req;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSector
+// 	Read the contents of a disk sector into a buffer, from the buffer
+//	cache if it is there.
+//
+//	"sectorNumber" -- the disk sector to read
+//	"data" -- the buffer to hold the contents of the disk sector
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSector(int sectorNumber, char* data)
+{
+    cacheLock->Acquire();
+    Cache *buf = GetBuffer(sectorNumber, TRUE);
+    bcopy(buf->data, data, SectorSize);
+    Unpin(buf);
+    cacheLock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteSector
+// 	Write the contents of a buffer into a disk sector.  The data goes
+//	into the buffer cache; it reaches the disk when the buffer is
+//	flushed or reused.
+//
+//	"sectorNumber" -- the disk sector to be written
+//	"data" -- the new contents of the disk sector
+//----------------------------------------------------------------------
+
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    cacheLock->Acquire();
+    Cache *buf = GetBuffer(sectorNumber, FALSE);	// no need to read it
+    bcopy(data, buf->data, SectorSize);
+    buf->valid = TRUE;
+    MarkDirty(buf);
+    Unpin(buf);
+    cacheLock->Release();
 }
 
-/*void SynchDisk::WriteSector(int sectorNumber, char* data){
-    if(cache->valid && cache->sector == sectorNumber){
-        //printf("cache hit!\n");
-        bcopy(data, cache->data, SectorSize);
-        cache->dirty = TRUE;
-        return;
+//----------------------------------------------------------------------
+// SynchDisk::ReadAhead
+// 	Queue "sectorNumber" to be read into the buffer cache by the
+//	read-ahead thread, and return at once.  It is only a hint: if the
+//	sector is cached already, or the queue is full, nothing happens.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadAhead(int sectorNumber)
+{
+    cacheLock->Acquire();
+    if (Lookup(sectorNumber) == NULL && raCount < ReadAheadQueue) {
+	bool queued = FALSE;
+
+	for (int i = 0; i < raCount; i++)
+	    if (readAhead[(raHead + i) % ReadAheadQueue] == sectorNumber)
+		queued = TRUE;
+	if (!queued) {
+	    readAhead[(raHead + raCount) % ReadAheadQueue] = sectorNumber;
+	    raCount++;
+	    readAheadWanted->V();
+	}
     }
-    
-    //printf("cache miss!\n");
-    if(cache->dirty){
-        oldWriteSector(cache->sector, cache->data);
+    cacheLock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadAheader
+// 	Body of the read-ahead thread: read each queued sector into the
+//	cache, in the order it was asked for.  Never returns; it sleeps
+//	on "readAheadWanted" while the queue is empty.
+//
+//	The buffer is busy while the read is in progress, so a thread
+//	that wants the sector meanwhile waits for this read to finish
+//	instead of issuing its own.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadAheader()
+{
+    for (;;) {
+	readAheadWanted->P();
+	cacheLock->Acquire();
+	int sectorNumber = readAhead[raHead];
+	raHead = (raHead + 1) % ReadAheadQueue;
+	raCount--;
+	if (Lookup(sectorNumber) == NULL) {	// not read in the meantime
+	    stats->numReadAheads++;
+	    Unpin(GetBuffer(sectorNumber, TRUE));
+	}
+	cacheLock->Release();
     }
-    
-    cache->valid = TRUE;
-    cache->sector = sectorNumber;
-    bcopy(data, cache->data, SectorSize);
-    cache->dirty = TRUE;
-    return;
-}*/
+}
 
 //----------------------------------------------------------------------
-// SynchDisk::RequestDone
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// SynchDisk::Lookup
+// 	Return the buffer assigned to "sectorNumber", or NULL if it isn't
+//	in the cache.  Called with cacheLock held.
+//----------------------------------------------------------------------
+
+Cache *
+SynchDisk::Lookup(int sectorNumber)
+{
+    Cache *buf;
+
+    for (buf = hashTable[sectorNumber % numBuffers]; buf != NULL;
+						buf = buf->hashNext)
+	if (buf->sector == sectorNumber)
+	    break;
+    return buf;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::GetBuffer
+// 	Return the buffer holding "sectorNumber", pinned.  On a miss, take
+//	the least recently used unpinned buffer, writing it back first if
+//	it is dirty, and (if "load") read the sector into it.
+//
+//	Called with cacheLock held; may give it up while waiting.
+//----------------------------------------------------------------------
+
+Cache *
+SynchDisk::GetBuffer(int sectorNumber, bool load)
+{
+    Cache *buf;
+
+    for (;;) {
+	buf = Lookup(sectorNumber);
+	if (buf != NULL) {			// hit, or being loaded
+	    if (buf->busy) {
+		bufferReady->Wait(cacheLock);
+		continue;
+	    }
+	    stats->numCacheHits++;
+	    buf->pinCount++;
+	    MakeMostRecent(buf);
+	    return buf;
+	}
+
+	for (buf = leastRecent; buf != NULL; buf = buf->lruPrev)
+	    if (buf->pinCount == 0 && !buf->busy)
+		break;
+	if (buf == NULL) {			// every buffer is in use
+	    bufferReady->Wait(cacheLock);
+	    continue;
+	}
+	if (buf->dirty) {			// write it back, then look again
+	    buf->busy = TRUE;
+	    cacheLock->Release();
+	    DiskWrite(buf->sector, buf->data);
+	    cacheLock->Acquire();
+	    buf->busy = FALSE;
+	    buf->dirty = FALSE;
+	    bufferReady->Broadcast(cacheLock);
+	    continue;
+	}
+	break;
+    }
+
+    stats->numCacheMisses++;
+    Unhash(buf);
+    buf->sector = sectorNumber;
+    buf->valid = FALSE;
+    buf->pinCount = 1;
+    buf->hashNext = hashTable[sectorNumber % numBuffers];
+    hashTable[sectorNumber % numBuffers] = buf;
+    MakeMostRecent(buf);
+    if (load) {
+	buf->busy = TRUE;
+	cacheLock->Release();
+	DiskRead(sectorNumber, buf->data);
+	cacheLock->Acquire();
+	buf->busy = FALSE;
+	buf->valid = TRUE;
+	bufferReady->Broadcast(cacheLock);
+    }
+    return buf;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Unpin
+// 	The caller is done with "buf"; if nobody else is using it, it may
+//	be reused.  Called with cacheLock held.
 //----------------------------------------------------------------------
 
 void
-SynchDisk::RequestDone()
-{ 
-    semaphore->V();
+SynchDisk::Unpin(Cache *buf)
+{
+    ASSERT(buf->pinCount > 0);
+    if (--buf->pinCount == 0)
+	bufferReady->Broadcast(cacheLock);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Unhash
+// 	Take "buf" out of the hash bucket for its sector, if it is in one.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Unhash(Cache *buf)
+{
+    if (buf->sector == -1)
+	return;
+    Cache **ptr = &hashTable[buf->sector % numBuffers];
+    while (*ptr != buf)
+	ptr = &(*ptr)->hashNext;
+    *ptr = buf->hashNext;
+    buf->hashNext = NULL;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::MakeMostRecent
+// 	Move "buf" to the front of the LRU list.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::MakeMostRecent(Cache *buf)
+{
+    if (buf == mostRecent)
+	return;
+    buf->lruPrev->lruNext = buf->lruNext;	// not first, so has a prev
+    if (buf->lruNext != NULL)
+	buf->lruNext->lruPrev = buf->lruPrev;
+    else
+	leastRecent = buf->lruPrev;
+    buf->lruPrev = NULL;
+    buf->lruNext = mostRecent;
+    mostRecent->lruPrev = buf;
+    mostRecent = buf;
 }
 
-void SynchDisk::P(int sector){
-    //printf("Sector %d locked..\n", sector);
-    diskSem[sector]->P();
+//----------------------------------------------------------------------
+// SynchDisk::MarkDirty
+// 	Note that "buf" must be written back, and arrange for the flusher
+//	to run within FlushInterval ticks.  The flush interrupt is only
+//	scheduled while something is dirty, so that an idle machine can
+//	still halt.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::MarkDirty(Cache *buf)
+{
+    buf->dirty = TRUE;
+    if (!flushScheduled) {
+	flushScheduled = TRUE;
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	interrupt->Schedule(DiskFlushTimer, (int) this, FlushInterval, DiskInt);
+	(void) interrupt->SetLevel(oldLevel);
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::FlushTimer
+// 	Called from the interrupt handler: wake up the flusher thread.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::FlushTimer()
+{
+    flushScheduled = FALSE;
+    flushWanted->V();
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Flusher
+// 	Body of the flusher thread: each time the flush interrupt goes
+//	off, write back the dirty buffers.  Never returns; while nothing
+//	is dirty it sleeps on "flushWanted", so it doesn't keep the
+//	machine from halting.
+//
+//	The headers of open files are written into the cache first, so
+//	that they go out with the data they describe.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Flusher()
+{
+    for (;;) {
+	flushWanted->P();
+	inodeTable->Sync();
+	Flush();
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Flush
+// 	Write every dirty buffer back to disk.  Called by the flusher
+//	thread, and by Interrupt::Halt so that nothing is lost.
+//
+//	The writes are all queued before waiting for any of them, so the
+//	disk scheduler can put them in order.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Flush()
+{
+    Cache **bufs = new Cache *[numBuffers];
+    DiskRequest **reqs = new DiskRequest *[numBuffers];
+    int i, numDirty = 0;
+
+    cacheLock->Acquire();
+    for (i = 0; i < numBuffers; i++) {
+	Cache *buf = &buffers[i];
+
+	while (buf->busy)
+	    bufferReady->Wait(cacheLock);
+	if (!buf->dirty)
+	    continue;
+	buf->busy = TRUE;
+	bufs[numDirty++] = buf;
+    }
+    cacheLock->Release();
+
+    for (i = 0; i < numDirty; i++) {
+	reqs[i] = new DiskRequest(bufs[i]->sector, bufs[i]->data, TRUE);
+	Submit(reqs[i]);
+    }
+    for (i = 0; i < numDirty; i++) {
+	reqs[i]->done->P();
+	delete reqs[i];
+    }
+
+    cacheLock->Acquire();
+    for (i = 0; i < numDirty; i++) {
+	bufs[i]->busy = FALSE;
+	bufs[i]->dirty = FALSE;
+    }
+    if (numDirty > 0)
+	bufferReady->Broadcast(cacheLock);
+    cacheLock->Release();
+    delete [] bufs;
+    delete [] reqs;
 }
 
-void SynchDisk::V(int sector){
-    diskSem[sector]->V();
-    //printf("Sector %d unlocked..\n", sector);
+//----------------------------------------------------------------------
+// SynchDisk::RequestDone
+// 	Disk interrupt handler.  Start the next request, so the disk
+//	keeps busy, and wake up the thread waiting for this one.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::RequestDone()
+{ 
+    DiskRequest *req = active;
+
+    ASSERT(req != NULL);
+    StartNext();
+    req->done->V();
 }
@@ -14,7 +14,10 @@
 #include "disk.h"
 #include "synch.h"
 
-#define cacheNum 3
+#define cacheNum 	32		// default number of sector buffers
+#define FlushInterval	10000		// ticks a dirty buffer may wait
+					// before it is written back
+#define ReadAheadQueue	32		// read-ahead requests not yet started
 
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
@@ -26,6 +29,52 @@
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.
+//
+// Sectors are kept in a buffer cache: lookups go through a hash table,
+// the least recently used unpinned buffer is reused on a miss, and
+// writes only mark the buffer dirty.  Dirty buffers are written back
+// by a flusher thread, at most FlushInterval ticks later, and by Flush
+// (which Interrupt::Halt calls).
+//
+// ReadAhead asks for a sector to be brought into the cache without
+// waiting for it; a read-ahead thread does the disk reads in the
+// background, so a later ReadSector finds the data already there.
+//
+// Requests for the disk itself are queued, and the interrupt handler
+// starts the next one as soon as the last is done.  Which one goes
+// next is up to the scheduling policy:
+//	DiskFIFO -- the order they came in
+//	DiskSSTF -- the one the head can get to soonest, counting both
+//		    the seek and the rotation (Disk::ComputeLatency);
+//		    far away requests can starve
+//	DiskCSCAN -- the next track up from the head, wrapping around to
+//		    the lowest, soonest first within a track; the head
+//		    sweeps the disk, so every request is reached
+// Flush queues all the dirty buffers at once, so the policy has
+// something to choose from even with a single thread running.
+
+enum DiskPolicy { DiskFIFO, DiskSSTF, DiskCSCAN };
+
+// A request waiting for the disk.
+
+class DiskRequest {
+  public:
+    DiskRequest(int sectorNumber, char *buffer, bool isWrite) {
+        sector = sectorNumber;
+        data = buffer;
+        writing = isWrite;
+        done = new Semaphore("disk request", 0);
+        next = NULL;
+    }
+    ~DiskRequest() { delete done; }
+
+    int sector;
+    char *data;
+    bool writing;
+    Semaphore *done;		// V'd by the interrupt handler once the
+				// request is finished
+    DiskRequest *next;		// next in the queue
+};
 
 class Cache{
 public:
@@ -33,18 +82,28 @@ public:
         valid = FALSE;
         sector = -1;
         dirty = FALSE;
+        busy = FALSE;
+        pinCount = 0;
+        hashNext = lruPrev = lruNext = NULL;
     }
     ~Cache(){}
     
     char data[SectorSize];
-    bool valid;
-    bool dirty;
-    int sector;
+    bool valid;			// does "data" hold the sector yet?
+    bool dirty;			// changed since it was read/written?
+    bool busy;			// being read from or written to disk
+    int sector;			// -1 if the buffer has never been used
+    int pinCount;		// threads using the buffer right now;
+				// a pinned buffer is never reused
+    Cache *hashNext;		// next buffer in the same hash bucket
+    Cache *lruPrev, *lruNext;	// neighbours, most recently used first
 };
 
 class SynchDisk {
   public:
-    SynchDisk(char* name);    		// Initialize a synchronous disk,
+    SynchDisk(char* name, int nBuffers = cacheNum,
+	      DiskPolicy diskPolicy = DiskCSCAN);
+					// Initialize a synchronous disk,
 					// by initializing the raw Disk.
     ~SynchDisk();			// De-allocate the synch disk data
     
@@ -56,28 +115,57 @@ class SynchDisk {
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, char* data);
     
-    //void oldReadSector(int sectorNumber, char* data);
-    
-    //void oldWriteSector(int sectorNumber, char* data);
+    void Flush();			// Write back every dirty buffer
+    void FlushTimer();			// Called by the interrupt handler
+					// when it is time to flush
+    void Flusher();			// Body of the flusher thread
+
+    void ReadAhead(int sectorNumber);	// Start reading a sector into the
+					// cache, but don't wait for it
+    void ReadAheader();			// Body of the read-ahead thread
     
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
-    void P(int sector);
-    
-    void V(int sector);
-    
-    int openCnt[NumSectors];
-    
-    Cache* cache;
 
   private:
+    void DiskRead(int sectorNumber, char* data);
+    void DiskWrite(int sectorNumber, char* data);
+					// Queue one request for the disk
+					// and wait for it
+    void Submit(DiskRequest *req);	// Queue a request, without waiting
+    void StartNext();			// Send the disk the next request
+    DiskRequest *PickNext();		// Take it off the queue
+    Cache *Lookup(int sectorNumber);	// Buffer holding a sector, or NULL
+    Cache *GetBuffer(int sectorNumber, bool load);
+					// Find or make the buffer for a
+					// sector, and pin it
+    void Unpin(Cache *buf);
+    void Unhash(Cache *buf);		// Take it out of its hash bucket
+    void MakeMostRecent(Cache *buf);	// Move it to the front of the LRU list
+    void MarkDirty(Cache *buf);		// and make sure a flush is coming
+
+    Cache *buffers;			// the buffer cache
+    int numBuffers;
+    Cache **hashTable;			// buffers by sector % numBuffers
+    Cache *mostRecent, *leastRecent;	// ends of the LRU list
+    Lock *cacheLock;			// protects the buffers' bookkeeping
+    Condition *bufferReady;		// a buffer stopped being busy,
+					// or was unpinned
+    Semaphore *flushWanted;		// V'd to wake the flusher thread
+    bool flushScheduled;		// is a flush interrupt pending?
+    int readAhead[ReadAheadQueue];	// sectors waiting to be read ahead,
+    int raHead, raCount;		// as a circular queue
+    Semaphore *readAheadWanted;		// V'd for each queued sector
+
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
-    Semaphore *diskSem[NumSectors];
+    DiskPolicy policy;			// how to choose the next request
+    DiskRequest *queue;			// requests not yet started, in the
+					// order they came in
+    DiskRequest *active;		// the one the disk is doing,
+					// NULL if it is idle
+					// (both only touched with interrupts
+					// off, as the handler changes them)
 };
 
 #endif // SYNCHDISK_H
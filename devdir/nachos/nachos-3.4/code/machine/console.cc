@@ -178,7 +178,7 @@ void SynchConsole::PutChar(char ch){
 
 char SynchConsole::GetChar(){
     readAvail->P();
-    console->GetChar();
+    return console->GetChar();
 }
 
 void SynchConsole::WriteDone(){
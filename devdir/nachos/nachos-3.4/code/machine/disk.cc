@@ -266,6 +266,7 @@ Disk::UpdateLast(int newSector)
     
     if (seek != 0)
 	bufferInit = stats->totalTicks + seek + rotate;
+    stats->diskSeekTicks += seek;
     lastSector = newSector;
     DEBUG('d', "Updating last sector = %d, %d\n", lastSector, bufferInit);
 }
@@ -74,6 +74,10 @@ class Disk {
     					// Return how long a request to 
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
+    int HeadSector() { return lastSector; }
+					// Where the last request was, so
+					// a scheduler can tell where the
+					// head is
 
   private:
     int fileno;				// UNIX file number for simulated disk 
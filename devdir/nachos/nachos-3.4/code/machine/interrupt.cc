@@ -48,6 +48,8 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time,
     arg = param;
     when = time;
     type = kind;
+    seq = 0;
+    heapIndex = -1;
 }
 
 //----------------------------------------------------------------------
@@ -60,7 +62,13 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time,
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new List();
+    pendingSize = InitialPendingSize;
+    pending = new PendingInterrupt *[pendingSize];
+    numPending = 0;
+    nextSeq = 0;
+    nextDue = NeverDue;
+    tickDebug = DebugIsEnabled('i');
+    freeInterrupts = new IntrusiveList<PendingInterrupt>;
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -73,9 +81,12 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty())
-	delete (PendingInterrupt *)pending->Remove();
-    delete pending;
+    for (int i = 0; i < numPending; i++)
+	delete pending[i];
+    while (!freeInterrupts->IsEmpty())
+	delete freeInterrupts->Remove();
+    delete [] pending;
+    delete freeInterrupts;
 }
 
 //----------------------------------------------------------------------
@@ -143,6 +154,10 @@ Interrupt::Enable()
 // 	Advance simulated time and check if there are any pending 
 //	interrupts to be called. 
 //
+//	The time the soonest pending interrupt is due is kept in
+//	"nextDue", so until then (and unless a yield is pending) all
+//	we need to do is advance the clock.
+//
 //	Two things can cause OneTick to be called:
 //		interrupts are re-enabled
 //		a user instruction is executed
@@ -151,6 +166,17 @@ void
 Interrupt::OneTick()
 {
     MachineStatus old = status;
+    int tick = (status == SystemMode) ? SystemTick : UserTick;
+
+    if (stats->totalTicks + tick < getNextDue()) {
+	// nothing can fire yet: just advance the clock, as below
+	stats->totalTicks += tick;
+	if (status == SystemMode)
+	    stats->systemTicks += tick;
+	else
+	    stats->userTicks += tick;
+	return;
+    }
 
 // advance simulated time
     if (status == SystemMode) {
@@ -207,6 +233,22 @@ Interrupt::YieldOnReturn()
     yieldOnReturn = TRUE; 
 }
 
+//----------------------------------------------------------------------
+// Interrupt::YieldWhenSafe
+// 	Like YieldOnReturn, but may be called from ordinary kernel code
+//	with interrupts off -- for example when a thread that should
+//	preempt the current one is put on the ready list in the middle of
+//	Semaphore::V.  The switch happens in OneTick, once interrupts are
+//	re-enabled and the caller has finished what it was doing.
+//----------------------------------------------------------------------
+
+void
+Interrupt::YieldWhenSafe()
+{
+    ASSERT(level == IntOff);
+    yieldOnReturn = TRUE;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::Idle
 // 	Routine called when there is nothing in the ready queue.
@@ -247,10 +289,19 @@ Interrupt::Idle()
 //----------------------------------------------------------------------
 // Interrupt::Halt
 // 	Shut down Nachos cleanly, printing out performance statistics.
+//	Dirty file headers and disk buffers are written back first, unless
+//	we got here from Idle -- then there is no thread context to wait
+//	in, and the flusher thread has already run.
 //----------------------------------------------------------------------
 void
 Interrupt::Halt()
 {
+#ifdef FILESYS
+    if (synchDisk != NULL && status != IdleMode) {
+	inodeTable->Sync();
+	synchDisk->Flush();
+    }
+#endif
     printf("Machine halting!\n\n");
     stats->Print();
     Cleanup();     // Never returns.
@@ -261,28 +312,154 @@ Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: put it in a binary heap ordered by time, so
+//	that scheduling costs O(log n) in the number of pending
+//	interrupts.  Interrupts due at the same time fire in the order
+//	they were scheduled, as they did on the old sorted list.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
 //
+//	Returns the interrupt, which may be passed to Cancel until it
+//	fires.
+//
 //	"handler" is the procedure to call when the interrupt occurs
 //	"arg" is the argument to pass to the procedure
 //	"fromNow" is how far in the future (in simulated time) the 
 //		 interrupt is to occur
 //	"type" is the hardware device that generated the interrupt
 //----------------------------------------------------------------------
-void
+PendingInterrupt *
 Interrupt::Schedule(VoidFunctionPtr handler, int arg, int fromNow, IntType type)
 {
     int when = stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(handler, arg, when, type);
+    PendingInterrupt *toOccur = freeInterrupts->Remove();
+
+    if (toOccur == NULL)
+	toOccur = new PendingInterrupt(handler, arg, when, type);
+    else {				// recycle one that has fired
+	toOccur->handler = handler;
+	toOccur->arg = arg;
+	toOccur->when = when;
+	toOccur->type = type;
+    }
 
     DEBUG('i', "Scheduling interrupt handler the %s at time = %d\n", 
 					intTypeNames[type], when);
     ASSERT(fromNow > 0);
 
-    pending->SortedInsert(toOccur, when);
+    if (numPending == pendingSize) {		// heap is full, double it
+	PendingInterrupt **bigger = new PendingInterrupt *[pendingSize * 2];
+
+	for (int i = 0; i < numPending; i++)
+	    bigger[i] = pending[i];
+	delete [] pending;
+	pending = bigger;
+	pendingSize *= 2;
+    }
+    toOccur->seq = nextSeq++;
+    toOccur->heapIndex = numPending;
+    pending[numPending++] = toOccur;
+    SiftUp(toOccur->heapIndex);
+    nextDue = pending[0]->when;
+    return toOccur;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Cancel
+// 	Remove an interrupt that was scheduled but has not fired yet,
+//	in O(log n).
+//
+//	"toCancel" is the value returned by Schedule
+//----------------------------------------------------------------------
+void
+Interrupt::Cancel(PendingInterrupt *toCancel)
+{
+    ASSERT(toCancel->heapIndex >= 0 && toCancel->heapIndex < numPending
+		&& pending[toCancel->heapIndex] == toCancel);
+
+    DEBUG('i', "Cancelling interrupt handler the %s at time = %d\n", 
+				intTypeNames[toCancel->type], toCancel->when);
+    RemovePending(toCancel->heapIndex);
+    freeInterrupts->Prepend(toCancel);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Before
+// 	Return TRUE if interrupt "a" is to fire before interrupt "b":
+//	it is due sooner, or at the same time but was scheduled first.
+//----------------------------------------------------------------------
+bool
+Interrupt::Before(PendingInterrupt *a, PendingInterrupt *b)
+{
+    if (a->when != b->when)
+	return a->when < b->when;
+    return (a->seq - b->seq) < 0;	// correct even if seq wraps
+}
+
+//----------------------------------------------------------------------
+// Interrupt::SiftUp, Interrupt::SiftDown
+// 	Move the interrupt in slot "i" towards the root (or towards
+//	the leaves) of the pending heap until it is in order, keeping
+//	each interrupt's heapIndex up to date.
+//----------------------------------------------------------------------
+void
+Interrupt::SiftUp(int i)
+{
+    PendingInterrupt *item = pending[i];
+
+    while (i > 0 && Before(item, pending[(i - 1) / 2])) {
+	pending[i] = pending[(i - 1) / 2];
+	pending[i]->heapIndex = i;
+	i = (i - 1) / 2;
+    }
+    pending[i] = item;
+    item->heapIndex = i;
+}
+
+void
+Interrupt::SiftDown(int i)
+{
+    PendingInterrupt *item = pending[i];
+
+    for (;;) {
+	int child = 2 * i + 1;
+
+	if (child >= numPending)
+	    break;
+	if (child + 1 < numPending && Before(pending[child + 1], pending[child]))
+	    child++;
+	if (!Before(pending[child], item))
+	    break;
+	pending[i] = pending[child];
+	pending[i]->heapIndex = i;
+	i = child;
+    }
+    pending[i] = item;
+    item->heapIndex = i;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::RemovePending
+// 	Take the interrupt in slot "i" out of the pending heap, filling
+//	the hole with the last interrupt in the heap.
+//----------------------------------------------------------------------
+void
+Interrupt::RemovePending(int i)
+{
+    PendingInterrupt *removed = pending[i];
+
+    numPending--;
+    if (i < numPending) {
+	pending[i] = pending[numPending];
+	pending[i]->heapIndex = i;
+	if (i > 0 && Before(pending[i], pending[(i - 1) / 2]))
+	    SiftUp(i);
+	else
+	    SiftDown(i);
+    }
+    removed->heapIndex = -1;
+    nextDue = (numPending > 0) ? pending[0]->when : NeverDue;
 }
 
 //----------------------------------------------------------------------
@@ -308,26 +485,25 @@ Interrupt::CheckIfDue(bool advanceClock)
 					// to invoke an interrupt handler
     if (DebugIsEnabled('i'))
 	DumpState();
-    PendingInterrupt *toOccur = 
-		(PendingInterrupt *)pending->SortedRemove(&when);
-
-    if (toOccur == NULL)		// no pending interrupts
+    if (numPending == 0)		// no pending interrupts
 	return FALSE;			
 
+    PendingInterrupt *toOccur = pending[0];	// the soonest
+    when = toOccur->when;
+
     if (advanceClock && when > stats->totalTicks) {	// advance the clock
 	stats->idleTicks += (when - stats->totalTicks);
 	stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {	// not time yet, put it back
-	pending->SortedInsert(toOccur, when);
+    } else if (when > stats->totalTicks) {	// not time yet, leave it
 	return FALSE;
     }
 
 // Check if there is nothing more to do, and if so, quit
     if ((status == IdleMode) && (toOccur->type == TimerInt) 
-				&& pending->IsEmpty()) {
-	 pending->SortedInsert(toOccur, when);
+				&& numPending == 1) {
 	 return FALSE;
     }
+    RemovePending(0);
 
     DEBUG('i', "Invoking interrupt handler for the %s at time %d\n", 
 			intTypeNames[toOccur->type], toOccur->when);
@@ -342,7 +518,7 @@ Interrupt::CheckIfDue(bool advanceClock)
     (*(toOccur->handler))(toOccur->arg);	// call the interrupt handler
     status = old;				// restore the machine status
     inHandler = FALSE;
-    delete toOccur;
+    freeInterrupts->Prepend(toOccur);		// keep it for Schedule
     return TRUE;
 }
 
@@ -374,7 +550,8 @@ Interrupt::DumpState()
 					intLevelNames[level]);
     printf("Pending interrupts:\n");
     fflush(stdout);
-    pending->Mapcar(PrintPending);
+    for (int i = 0; i < numPending; i++)	// in heap order, not by time
+	PrintPending((int) pending[i]);
     printf("End of pending interrupts\n");
     fflush(stdout);
 }
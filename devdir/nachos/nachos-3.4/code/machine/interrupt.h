@@ -37,6 +37,7 @@
 
 #include "copyright.h"
 #include "list.h"
+#include "ilist.h"
 
 // Interrupts can be disabled (IntOff) or enabled (IntOn)
 enum IntStatus { IntOff, IntOn };
@@ -67,8 +68,15 @@ class PendingInterrupt {
     int arg;                    // The argument to the function.
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    int seq;			// order of scheduling, to break ties
+    int heapIndex;		// position in the pending heap, -1 if
+				// it has fired or been cancelled
+    ListLink<PendingInterrupt> link;	// on the free list
 };
 
+#define InitialPendingSize	64	// pending heap slots to start with
+#define NeverDue	0x7fffffff	// nextDue when nothing is pending
+
 // The following class defines the data structures for the simulation
 // of hardware interrupts.  We record whether interrupts are enabled
 // or disabled, and any hardware interrupts that are scheduled to occur
@@ -94,6 +102,8 @@ class Interrupt {
     
     void YieldOnReturn();		// cause a context switch on return 
 					// from an interrupt handler
+    void YieldWhenSafe();		// cause a context switch the next
+					// time interrupts are turned back on
 
     MachineStatus getStatus() { return status; } // idle, kernel, user
     void setStatus(MachineStatus st) { status = st; }
@@ -106,16 +116,34 @@ class Interrupt {
     // but they need to be public since they are called by the
     // hardware device simulators.
 
-    void Schedule(VoidFunctionPtr handler,// Schedule an interrupt to occur
+    PendingInterrupt *Schedule(VoidFunctionPtr handler,
+				// Schedule an interrupt to occur
 	int arg, int when, IntType type);// at time ``when''.  This is called
     					// by the hardware device simulators.
+    void Cancel(PendingInterrupt *toCancel);
+					// Take back an interrupt that has
+					// been scheduled but not yet fired
     
     void OneTick();       		// Advance simulated time
+    int getNextDue() { return yieldOnReturn || tickDebug ? 0 : nextDue; }
+					// Time before which OneTick would
+					// have nothing to do except advance
+					// the clock
 
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    List *pending;		// the list of interrupts scheduled
-				// to occur in the future
+    PendingInterrupt **pending;	// binary heap of the interrupts
+				// scheduled to occur in the future,
+				// soonest at pending[0]
+    int numPending;		// interrupts in the heap
+    int pendingSize;		// slots allocated for the heap
+    int nextSeq;		// seq for the next interrupt scheduled
+    int nextDue;		// when pending[0] is due, NeverDue if
+				// the heap is empty
+    bool tickDebug;		// print every tick?  (debug flag 'i')
+    IntrusiveList<PendingInterrupt> *freeInterrupts;
+				// interrupts that have fired, kept
+				// for reuse by Schedule
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
@@ -125,6 +153,11 @@ class Interrupt {
 
     bool CheckIfDue(bool advanceClock); // Check if an interrupt is supposed
 					// to occur now
+    bool Before(PendingInterrupt *a, PendingInterrupt *b);
+					// Should "a" fire before "b"?
+    void SiftUp(int i);			// Restore heap order above slot i
+    void SiftDown(int i);		// Restore heap order below slot i
+    void RemovePending(int i);		// Take slot i out of the heap
 
     void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
 	IntStatus now);  		// simulated time
@@ -80,11 +80,14 @@ Machine::Machine(bool debug)
     
     memoryMap = new BitMap(NumPhysPages);
     for(i=0; i<NumPhysPages; ++i)
-        pageBelong[i] = -1;
+        pageBelong[i] = NULL;
     
     for(i=0; i<NumPhysPages; ++i)
         pageLRUtime[i] = 0;
     
+    for(i=0; i<NumPhysPages; ++i)
+        frameRef[i] = 0;
+    
     swapArea = new swapPage[swapPageNum];
     swapNum = 0;
 }
@@ -299,14 +302,15 @@ void Machine::LRUReplace(unsigned int vpn){
 }
 
 //return a replaced physical page number
+//pinned shared memory frames (frameRef > 0) are skipped, so take the
+//least recently used of the others
 int Machine::pageLRUReplace(){
     int t = -1;
     for(int i=0; i<NumPhysPages; ++i){
-        if(pageLRUtime[i] == NumPhysPages-1){
+        if(frameRef[i] == 0 && (t == -1 || pageLRUtime[i] > pageLRUtime[t]))
             t = i;
-            break;
-        }
     }
+    ASSERT(t != -1);
     for(int i=0; i<NumPhysPages; ++i)
         pageLRUtime[i]++;
     pageLRUtime[t] = 0;
@@ -320,10 +324,10 @@ void Machine::printTLB(){
 
 void Machine::printPageBelong(){
     for(int i=0; i<NumPhysPages/2; ++i)
-        printf("%d ", pageBelong[i]);
+        printf("%p ", (void *) pageBelong[i]);
     printf("\n");
     for(int i=NumPhysPages/2; i<NumPhysPages; ++i)
-        printf("%d ", pageBelong[i]);
+        printf("%p ", (void *) pageBelong[i]);
     printf("\n");
 }
 
@@ -107,14 +107,19 @@ class Instruction {
 
 #define swapPageNum 100
 
+class AddrSpace;
+
+// A swapped-out page, named by the address space it belongs to (not
+// by a thread: threads made by ThreadCreate share one address space).
+
 class swapPage{
 public:
-    int tid;
+    AddrSpace *space;
     int vpn;
     char page[PageSize];
     
     swapPage(){
-        tid = -1;
+        space = NULL;
         vpn = -1;
         for(int i=0; i<PageSize; ++i)
             page[i] = 0;
@@ -170,13 +175,16 @@ class Machine {
     int tlbHit;
     int TLBPageFaultHandler();
     void printTLB();
-    int pageBelong[NumPhysPages];
+    AddrSpace *pageBelong[NumPhysPages];	// address space using each
+					// frame, NULL if none
     void printPageBelong();
     
     BitMap* memoryMap;
     
     int pageLRUtime[NumPhysPages];
     int pageLRUReplace();
+    int frameRef[NumPhysPages];		// references to a shared memory
+					// frame; never evicted while > 0
     
     swapPage *swapArea;
     int swapNum;
@@ -38,7 +38,11 @@ Machine::Run()
     interrupt->setStatus(UserMode);
     for (;;) {
         OneInstruction(instr);
-	interrupt->OneTick();
+	if (stats->totalTicks + UserTick < interrupt->getNextDue()) {
+	    stats->totalTicks += UserTick;	// nothing is due yet, so
+	    stats->userTicks += UserTick;	// this is all OneTick would do
+	} else
+	    interrupt->OneTick();
 	if (singleStep && (runUntilTime <= stats->totalTicks))
 	  Debugger();
     }
@@ -19,9 +19,12 @@
 Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
-    numDiskReads = numDiskWrites = 0;
+    numDiskReads = numDiskWrites = diskSeekTicks = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numPriorityInversions = numPriorityDonations = 0;
+    numCacheHits = numCacheMisses = numReadAheads = 0;
+    numDentryHits = numDentryMisses = 0;
 }
 
 //----------------------------------------------------------------------
@@ -35,10 +38,22 @@ Statistics::Print()
 {
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks, 
 	idleTicks, systemTicks, userTicks);
-    printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
+    printf("Disk I/O: reads %d, writes %d, seek ticks %d\n", numDiskReads,
+	numDiskWrites, diskSeekTicks);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
     printf("Paging: faults %d\n", numPageFaults);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
+    if (numPriorityInversions > 0)
+	printf("Priority inversions %d, donations %d\n",
+	       numPriorityInversions, numPriorityDonations);
+    if (numCacheHits + numCacheMisses > 0)
+	printf("Buffer cache: hits %d, misses %d (%d%% hit rate), "
+	       "read ahead %d\n", numCacheHits, numCacheMisses,
+	       numCacheHits * 100 / (numCacheHits + numCacheMisses),
+	       numReadAheads);
+    if (numDentryHits + numDentryMisses > 0)
+	printf("Dentry cache: hits %d, misses %d\n", numDentryHits,
+	       numDentryMisses);
 }
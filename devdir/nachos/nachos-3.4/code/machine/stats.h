@@ -30,11 +30,22 @@ class Statistics {
 
     int numDiskReads;		// number of disk read requests
     int numDiskWrites;		// number of disk write requests
+    int diskSeekTicks;		// time the disk head spent seeking
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numPriorityInversions;	// times a thread had to wait for a lock
+				// held by a less urgent thread
+    int numPriorityDonations;	// priority boosts given to lock holders,
+				// counting each step along a chain
+    int numCacheHits;		// sectors found in the buffer cache
+    int numCacheMisses;		// sectors that needed a buffer of their own
+    int numReadAheads;		// of those, sectors read before they
+				// were asked for
+    int numDentryHits;		// names found in the dentry cache
+    int numDentryMisses;	// names that needed a directory read
 
     Statistics(); 		// initialize everything to zero
 
@@ -501,3 +501,30 @@ DeallocBoundedArray(char *ptr, int size)
     mprotect(ptr + size, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
     delete [] (ptr - pgSize);
 }
+
+//----------------------------------------------------------------------
+// HostPageSize
+// 	Return the page size of the host machine, in bytes.
+//----------------------------------------------------------------------
+
+int
+HostPageSize()
+{
+    return getpagesize();
+}
+
+//----------------------------------------------------------------------
+// SetGuardPage
+// 	Make a host page inaccessible, so that any reference to it faults,
+//	or make it usable again before it is freed.
+//
+//	"page" -- the page, aligned to HostPageSize()
+//	"guard" -- TRUE to protect the page, FALSE to unprotect it
+//----------------------------------------------------------------------
+
+void
+SetGuardPage(char *page, bool guard)
+{
+    mprotect(page, getpagesize(),
+	     guard ? PROT_NONE : (PROT_READ | PROT_WRITE | PROT_EXEC));
+}
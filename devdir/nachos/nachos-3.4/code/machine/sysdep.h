@@ -55,6 +55,10 @@ extern int Random();
 extern char *AllocBoundedArray(int size);
 extern void DeallocBoundedArray(char *p, int size);
 
+// Size of a host page, and make one inaccessible (or accessible again)
+extern int HostPageSize();
+extern void SetGuardPage(char *page, bool guard);
+
 // Other C library routines that are used by Nachos.
 // These are assumed to be portable, so we don't include a wrapper.
 extern "C" {
@@ -45,13 +45,16 @@ Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
 //      Initialize a single mail box within the post office, so that it
 //	can receive incoming messages.
 //
-//	Just initialize a list of messages, representing the mailbox.
+//	Just initialize a list of messages, representing the mailbox,
+//	and the lock and condition that make it a synchronized list.
 //----------------------------------------------------------------------
 
 
 MailBox::MailBox()
 { 
-    messages = new SynchList(); 
+    messages = new IntrusiveList<Mail>; 
+    lock = new Lock("mailbox lock");
+    listEmpty = new Condition("mailbox list empty cond");
 }
 
 //----------------------------------------------------------------------
@@ -64,7 +67,11 @@ MailBox::MailBox()
 
 MailBox::~MailBox()
 { 
+    while (!messages->IsEmpty())
+	delete messages->Remove();
     delete messages; 
+    delete lock;
+    delete listEmpty;
 }
 
 //----------------------------------------------------------------------
@@ -89,7 +96,7 @@ PrintHeader(PacketHeader pktHdr, MailHeader mailHdr)
 //	arrival, wake them up!
 //
 //	We need to reconstruct the Mail message (by concatenating the headers
-//	to the data), to simplify queueing the message on the SynchList.
+//	to the data), to simplify queueing the message on the mailbox list.
 //
 //	"pktHdr" -- source, destination machine ID's
 //	"mailHdr" -- source, destination mailbox ID's
@@ -101,9 +108,12 @@ MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, char *data)
 { 
     Mail *mail = new Mail(pktHdr, mailHdr, data); 
 
-    messages->Append((void *)mail);	// put on the end of the list of 
+    lock->Acquire();
+    messages->Append(mail);		// put on the end of the list of 
 					// arrived messages, and wake up 
 					// any waiters
+    listEmpty->Signal(lock);
+    lock->Release();
 }
 
 //----------------------------------------------------------------------
@@ -122,8 +132,11 @@ void
 MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data) 
 { 
     DEBUG('n', "Waiting for mail in mailbox\n");
-    Mail *mail = (Mail *) messages->Remove();	// remove message from list;
-						// will wait if list is empty
+    lock->Acquire();
+    while (messages->IsEmpty())
+	listEmpty->Wait(lock);			// wait until there is mail
+    Mail *mail = messages->Remove();		// remove message from list
+    lock->Release();
 
     *pktHdr = mail->pktHdr;
     *mailHdr = mail->mailHdr;
@@ -30,6 +30,7 @@
 
 #include "network.h"
 #include "synchlist.h"
+#include "ilist.h"
 
 // Mailbox address -- uniquely identifies a mailbox on a given machine.
 // A mailbox is just a place for temporary storage for messages.
@@ -68,6 +69,7 @@ class Mail {
      PacketHeader pktHdr;	// Header appended by Network
      MailHeader mailHdr;	// Header appended by PostOffice
      char data[MaxMailSize];	// Payload -- message data
+     ListLink<Mail> link;	// on the list of its mailbox
 };
 
 // The following class defines a single mailbox, or temporary storage
@@ -87,7 +89,10 @@ class MailBox {
 				// mailbox (and wait if there is no message 
 				// to get!)
   private:
-    SynchList *messages;	// A mailbox is just a list of arrived messages
+    IntrusiveList<Mail> *messages;	// A mailbox is just a list of 
+					// arrived messages
+    Lock *lock;			// enforce mutual exclusive access to the list
+    Condition *listEmpty;	// wait in Get if the list is empty
 };
 
 // The following class defines a "Post Office", or a collection of 
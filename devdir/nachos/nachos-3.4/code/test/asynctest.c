@@ -0,0 +1,43 @@
+/* asynctest.c
+ *	Test program for the asynchronous file I/O system calls.
+ *
+ *	Start a write, keep computing while the disk works, collect the
+ *	completion with WaitAny, then read the data back with AsyncRead
+ *	and Poll.
+ */
+
+#include "syscall.h"
+
+char data[] = "overlap compute with disk latency";
+char back[40];
+
+int
+main()
+{
+    OpenFileId fd;
+    int req, n, i, sum;
+
+    Create("async.txt");
+    fd = Open("async.txt");
+
+    req = AsyncWrite(data, 33, fd);
+    sum = 0;
+    for (i = 0; i < 1000; i++)		/* work while the write is in flight */
+	sum += i;
+    if (WaitAny(&n) != req || n != 33)
+	Exit(1);
+    Close(fd);
+
+    fd = Open("async.txt");
+    req = AsyncRead(back, 33, fd);
+    while ((n = Poll(req)) == -1)	/* Poll yields to the worker */
+	sum++;
+    Close(fd);
+    if (n != 33)
+	Exit(3);
+
+    for (i = 0; i < 33; i++)
+	if (back[i] != data[i])
+	    Exit(2);
+    Exit(0);
+}
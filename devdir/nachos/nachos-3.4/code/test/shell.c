@@ -1,12 +1,36 @@
 #include "syscall.h"
 
+/* Split "line" into words in place, and Spawn the program it names */
+SpaceId
+Run(char *line)
+{
+    char *argv[MaxSpawnArgs + 1];
+    int argc = 0;
+
+    while (*line != '\0' && argc < MaxSpawnArgs) {
+	while (*line == ' ')
+	    *line++ = '\0';
+	if (*line == '\0')
+	    break;
+	argv[argc++] = line;
+	while (*line != ' ' && *line != '\0')
+	    line++;
+    }
+    argv[argc] = 0;
+    if (argc == 0)
+	return -1;
+    return Spawn(argv[0], argv);
+}
+
 int
 main()
 {
-    SpaceId newProc;
+    SpaceId newProc, left;
     OpenFileId input = ConsoleInput;
     OpenFileId output = ConsoleOutput;
+    OpenFileId fds[2];
     char prompt[2], ch, buffer[60];
+    char *second;
     int i;
 
     prompt[0] = '-';
@@ -26,10 +50,38 @@ main()
 
 	buffer[--i] = '\0';
 
-	if( i > 0 ) {
-		newProc = Exec(buffer);
-		Join(newProc);
+	/* "a | b" runs a and b with a's output piped into b's input */
+	second = 0;
+	for (i = 0; buffer[i] != '\0'; i++)
+	    if (buffer[i] == '|') {
+		buffer[i] = '\0';
+		second = &buffer[i + 1];
+		while (*second == ' ')
+		    second++;
+		while (i > 0 && buffer[i - 1] == ' ')
+		    buffer[--i] = '\0';
+		break;
+	    }
+
+	if( second != 0 && buffer[0] != '\0' && *second != '\0' ) {
+		if (Pipe(fds) == -1)
+		    continue;
+		Dup2(fds[1], ConsoleOutput);
+		left = Run(buffer);
+		Dup2(ConsoleOutput, ConsoleOutput);
+		Close(fds[1]);
+		Dup2(fds[0], ConsoleInput);
+		newProc = Run(second);
+		Dup2(ConsoleInput, ConsoleInput);
+		Close(fds[0]);
+		if (left != -1)
+		    Join(left);
+		if (newProc != -1)
+		    Join(newProc);
+	} else if( i > 0 ) {
+		newProc = Run(buffer);
+		if (newProc != -1)
+		    Join(newProc);
 	}
     }
 }
-
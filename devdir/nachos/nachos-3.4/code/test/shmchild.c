@@ -0,0 +1,27 @@
+/* shmchild.c
+ *	The other half of shmtest: attach its segment, take the numbers
+ *	it passes, and exit with their sum.
+ */
+
+#include "syscall.h"
+
+#define ShmKey		42
+#define NMessages	10
+
+int
+main()
+{
+    int *shm, i, sum;
+
+    shm = (int *) ShmAttach(ShmCreate(ShmKey, 64));
+    if (shm == (int *) -1)
+	Exit(-1);
+    sum = 0;
+    for (i = 0; i < NMessages; i++) {
+	SemWait(shm[1]);
+	sum += shm[2];
+	SemSignal(shm[0]);
+    }
+    ShmDetach((char *) shm);
+    Exit(sum);
+}
@@ -0,0 +1,45 @@
+/* shmtest.c
+ *	Test program for shared memory and semaphores.
+ *
+ *	Create a shared segment and two semaphores, and start shmchild,
+ *	which attaches the same segment.  Then pass it a series of numbers
+ *	one at a time through the segment: "empty" says the slot may be
+ *	filled, "full" that it holds a number.  shmchild exits with the
+ *	sum it saw, which must match.
+ */
+
+#include "syscall.h"
+
+#define ShmKey		42
+#define NMessages	10
+
+int
+main()
+{
+    int id, *shm, i, sum;
+    SpaceId child;
+
+    if ((id = ShmCreate(ShmKey, 64)) == -1)
+	Exit(1);
+    if ((shm = (int *) ShmAttach(id)) == (int *) -1)
+	Exit(2);
+    shm[0] = SemCreate(1);		/* empty */
+    shm[1] = SemCreate(0);		/* full */
+    if (shm[0] == -1 || shm[1] == -1)
+	Exit(3);
+
+    if ((child = Exec("../test/shmchild")) == -1)
+	Exit(4);
+    sum = 0;
+    for (i = 1; i <= NMessages; i++) {
+	SemWait(shm[0]);
+	shm[2] = i;
+	sum += i;
+	SemSignal(shm[1]);
+    }
+    if (Join(child) != sum)
+	Exit(5);
+    if (ShmDetach((char *) shm) == -1)
+	Exit(6);
+    Exit(0);
+}
@@ -130,6 +130,158 @@ Yield:
 	j	$31
 	.end Yield
 
+	.globl AsyncRead
+	.ent	AsyncRead
+AsyncRead:
+	addiu $2,$0,SC_AsyncRead
+	syscall
+	j	$31
+	.end AsyncRead
+
+	.globl AsyncWrite
+	.ent	AsyncWrite
+AsyncWrite:
+	addiu $2,$0,SC_AsyncWrite
+	syscall
+	j	$31
+	.end AsyncWrite
+
+	.globl WaitAny
+	.ent	WaitAny
+WaitAny:
+	addiu $2,$0,SC_WaitAny
+	syscall
+	j	$31
+	.end WaitAny
+
+	.globl Poll
+	.ent	Poll
+Poll:
+	addiu $2,$0,SC_Poll
+	syscall
+	j	$31
+	.end Poll
+
+	.globl Pipe
+	.ent	Pipe
+Pipe:
+	addiu $2,$0,SC_Pipe
+	syscall
+	j	$31
+	.end Pipe
+
+	.globl Dup2
+	.ent	Dup2
+Dup2:
+	addiu $2,$0,SC_Dup2
+	syscall
+	j	$31
+	.end Dup2
+
+	.globl ShmCreate
+	.ent	ShmCreate
+ShmCreate:
+	addiu $2,$0,SC_ShmCreate
+	syscall
+	j	$31
+	.end ShmCreate
+
+	.globl ShmAttach
+	.ent	ShmAttach
+ShmAttach:
+	addiu $2,$0,SC_ShmAttach
+	syscall
+	j	$31
+	.end ShmAttach
+
+	.globl ShmDetach
+	.ent	ShmDetach
+ShmDetach:
+	addiu $2,$0,SC_ShmDetach
+	syscall
+	j	$31
+	.end ShmDetach
+
+	.globl SemCreate
+	.ent	SemCreate
+SemCreate:
+	addiu $2,$0,SC_SemCreate
+	syscall
+	j	$31
+	.end SemCreate
+
+	.globl SemWait
+	.ent	SemWait
+SemWait:
+	addiu $2,$0,SC_SemWait
+	syscall
+	j	$31
+	.end SemWait
+
+	.globl SemSignal
+	.ent	SemSignal
+SemSignal:
+	addiu $2,$0,SC_SemSignal
+	syscall
+	j	$31
+	.end SemSignal
+
+	.globl Spawn
+	.ent	Spawn
+Spawn:
+	addiu $2,$0,SC_Spawn
+	syscall
+	j	$31
+	.end Spawn
+
+	.globl ThreadCreate
+	.ent	ThreadCreate
+ThreadCreate:
+	la	$7,__thread_exit	/* where "func" returns to */
+	addiu $2,$0,SC_ThreadCreate
+	syscall
+	j	$31
+	.end ThreadCreate
+
+	.ent	__thread_exit
+__thread_exit:
+	move	$4,$2		/* exit with the return value of "func" */
+	addiu $2,$0,SC_ExitThread
+	syscall
+	.end __thread_exit
+
+	.globl ExitThread
+	.ent	ExitThread
+ExitThread:
+	addiu $2,$0,SC_ExitThread
+	syscall
+	j	$31
+	.end ExitThread
+
+	.globl ThreadJoin
+	.ent	ThreadJoin
+ThreadJoin:
+	addiu $2,$0,SC_ThreadJoin
+	syscall
+	j	$31
+	.end ThreadJoin
+
+	.globl FutexWait
+	.ent	FutexWait
+FutexWait:
+	addiu $2,$0,SC_FutexWait
+	syscall
+	j	$31
+	.end FutexWait
+
+	.globl FutexWake
+	.ent	FutexWake
+FutexWake:
+	addiu $2,$0,SC_FutexWake
+	syscall
+	j	$31
+	.end FutexWake
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
@@ -0,0 +1,74 @@
+/* uthreads.c
+ *	Test program for user-level threads and futexes.
+ *
+ *	Start a few threads, each on a stack the kernel gives it, and have
+ *	them take turns appending to a shared array: a thread sleeps in
+ *	FutexWait until "turn" names it, then hands the turn on and wakes
+ *	the others.  Join them all and check their exit status and the
+ *	order they ran in.  Finally create and join threads one after
+ *	another, more than a program can have at once, to check that their
+ *	slots and stacks are given back.
+ */
+
+#include "syscall.h"
+
+#define NThreads	3
+#define Rounds		4
+
+int turn;				/* thread whose turn it is */
+int order[NThreads * Rounds];		/* who ran, in order */
+int pos;
+int *stackAt[NThreads];			/* where each thread's stack is */
+
+int
+worker(int me)
+{
+    int r, t;
+
+    stackAt[me] = &r;
+    for (r = 0; r < Rounds; r++) {
+	while ((t = turn) != me)
+	    FutexWait(&turn, t);
+	order[pos++] = me;
+	turn = (me + 1) % NThreads;
+	FutexWake(&turn, NThreads);
+    }
+    if (me == NThreads - 1)
+	ExitThread(me + 10);		/* the others just return */
+    return me + 10;
+}
+
+int
+nothing(int arg)
+{
+    return arg;
+}
+
+int
+main()
+{
+    int tid[NThreads];
+    int i, j;
+
+    for (i = 0; i < NThreads; i++)
+	if ((tid[i] = ThreadCreate(worker, i, 0)) == -1)
+	    Exit(1);
+    for (i = 0; i < NThreads; i++)
+	if (ThreadJoin(tid[i]) != i + 10)
+	    Exit(2);
+
+    for (i = 0; i < NThreads * Rounds; i++)
+	if (order[i] != i % NThreads)
+	    Exit(3);
+    for (i = 0; i < NThreads; i++)
+	for (j = i + 1; j < NThreads; j++)
+	    if (stackAt[i] == stackAt[j])
+		Exit(4);
+
+    for (i = 0; i < 20; i++) {
+	j = ThreadCreate(nothing, i, 0);
+	if (j == -1 || ThreadJoin(j) != i)
+	    Exit(5);
+    }
+    Exit(0);
+}
@@ -0,0 +1,213 @@
+// ilist.h
+//	Data structures to manage intrusive lists.
+//
+//	A List (list.h) allocates a ListElement for every item put on it,
+//	and frees it when the item comes off.  That is a heap allocation
+//	each time a thread goes to sleep, becomes ready, or an interrupt
+//	is scheduled.
+//
+//	An IntrusiveList instead links the items themselves together:
+//	each item class embeds a "ListLink" named "link", which holds the
+//	next pointer and sort key.  Nothing is allocated, but an item can
+//	be on at most one intrusive list at a time.
+//
+//	For example, a Thread is on the ready list, or on the wait queue
+//	of one Semaphore or Condition, but never on two at once.
+//
+//	The routines are defined here, since the list is a template.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef ILIST_H
+#define ILIST_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// The link embedded in every item that can go on an IntrusiveList<T>.
+
+template <class T>
+class ListLink {
+  public:
+    ListLink() { next = NULL; key = 0; onList = FALSE; }
+
+    T *next;			// next item on the list, NULL if last
+    int key;			// priority, for a sorted list
+    bool onList;		// is the item on a list right now?
+};
+
+// A singly linked list of items of class T, kept through "T::link".
+// The interface is the same as List's.
+
+template <class T>
+class IntrusiveList {
+  public:
+    IntrusiveList() { first = last = NULL; }
+    ~IntrusiveList() {}		// the items are not ours to delete
+
+    void Prepend(T *item);	// Put item at the beginning of the list
+    void Append(T *item);	// Put item at the end of the list
+    T *Remove() { return SortedRemove(NULL); }
+				// Take item off the front of the list
+
+    void Mapcar(VoidFunctionPtr func);	// Apply "func" to every item
+    bool IsEmpty() { return first == NULL; }
+    T *First() { return first; }	// Front item, left on the list;
+					// follow link.next for the rest
+    void RemoveItem(T *item);		// Take "item" off, wherever it is
+
+    // Routines to put/get items on/off list in order (sorted by key)
+    void SortedInsert(T *item, int sortKey);	// Put item into list
+    T *SortedRemove(int *keyPtr);		// Remove first item from list
+
+  private:
+    T *first;			// Head of the list, NULL if list is empty
+    T *last;			// Last item on the list
+};
+
+//----------------------------------------------------------------------
+// IntrusiveList::Prepend
+//      Put an item at the beginning of the list.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+IntrusiveList<T>::Prepend(T *item)
+{
+    ASSERT(!item->link.onList);
+    item->link.onList = TRUE;
+    item->link.key = 0;
+    item->link.next = first;
+    if (first == NULL)
+	last = item;
+    first = item;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::Append
+//      Put an item at the end of the list.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+IntrusiveList<T>::Append(T *item)
+{
+    ASSERT(!item->link.onList);
+    item->link.onList = TRUE;
+    item->link.key = 0;
+    item->link.next = NULL;
+    if (first == NULL)
+	first = item;
+    else
+	last->link.next = item;
+    last = item;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::RemoveItem
+//      Take an item off the list, wherever it is.  This walks the
+//	list, so it is O(n); the common case is still Remove.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+IntrusiveList<T>::RemoveItem(T *item)
+{
+    T *prev = NULL;
+    T *ptr = first;
+
+    while (ptr != NULL && ptr != item) {
+	prev = ptr;
+	ptr = ptr->link.next;
+    }
+    ASSERT(ptr != NULL);		// it must be on this list
+    if (prev == NULL)
+	first = item->link.next;
+    else
+	prev->link.next = item->link.next;
+    if (last == item)
+	last = prev;
+    item->link.next = NULL;
+    item->link.onList = FALSE;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::Mapcar
+//	Apply a function to each item on the list, by walking through
+//	the list, one item at a time.
+//
+//	"func" is the procedure to apply to each item on the list.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+IntrusiveList<T>::Mapcar(VoidFunctionPtr func)
+{
+    for (T *ptr = first; ptr != NULL; ptr = ptr->link.next) {
+       DEBUG('l', "In mapcar, about to invoke %x(%x)\n", func, ptr);
+       (*func)((int) ptr);
+    }
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::SortedInsert
+//      Insert an item into the list, so that the list elements are
+//	sorted in increasing order by "sortKey".  Items with equal keys
+//	stay in the order they were inserted.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+IntrusiveList<T>::SortedInsert(T *item, int sortKey)
+{
+    ASSERT(!item->link.onList);
+    item->link.onList = TRUE;
+    item->link.key = sortKey;
+    if (first == NULL) {
+	item->link.next = NULL;
+	first = last = item;
+    } else if (sortKey < first->link.key) {
+	item->link.next = first;
+	first = item;
+    } else if (sortKey >= last->link.key) {	// common case: goes at end
+	item->link.next = NULL;
+	last->link.next = item;
+	last = item;
+    } else {
+	T *ptr = first;
+
+	while (ptr->link.next->link.key <= sortKey)
+	    ptr = ptr->link.next;
+	item->link.next = ptr->link.next;
+	ptr->link.next = item;
+    }
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::SortedRemove
+//      Remove the first item from the list, returning it (NULL if the
+//	list is empty).  If "keyPtr" is not NULL, its key is stored there.
+//----------------------------------------------------------------------
+
+template <class T>
+T *
+IntrusiveList<T>::SortedRemove(int *keyPtr)
+{
+    T *item = first;
+
+    if (item == NULL)
+	return NULL;
+    if (first == last)
+	first = last = NULL;
+    else
+	first = item->link.next;
+    item->link.next = NULL;
+    item->link.onList = FALSE;
+    if (keyPtr != NULL)
+	*keyPtr = item->link.key;
+    return item;
+}
+
+#endif // ILIST_H
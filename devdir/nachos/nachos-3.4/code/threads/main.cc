@@ -18,6 +18,12 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -mlfq schedules with a multi-level feedback queue, given the
+//	quantum in ticks of each level, highest priority first ("100,200,400")
+//    -boost sets how many ticks pass between MLFQ priority boosts
+//    -noguard leaves out the inaccessible page below every thread stack
+//    -lp profiles contention on locks, semaphores and conditions,
+//	and writes the counts as CSV if followed by a file name
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
@@ -33,6 +39,9 @@
 //    -l lists the contents of the Nachos directory
 //    -D prints the contents of the entire file system
 //    -t tests the performance of the Nachos file system
+//    -cb sets the number of sectors kept in the buffer cache
+//    -ds sets the disk scheduling policy: fifo, sstf or cscan
+//    -dt measures the disk scheduler with several threads at once
 //
 //  NETWORK
 //    -n sets the network reliability
@@ -61,6 +70,7 @@ extern int testnum;
 
 extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(void), OpenFileTest(void), BlockTest(void);
+extern void DiskSchedTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
 extern void MailTest(int networkID);
 extern void PipeTest1(void), PipeTest2(void);
@@ -155,6 +165,8 @@ main(int argc, char **argv)
             OpenFileTest();
         } else if (!strcmp(*argv, "-ttt")) {    // performance test
             BlockTest();
+        } else if (!strcmp(*argv, "-dt")) {    // disk scheduling test
+            DiskSchedTest();
         } else if (!strcmp(*argv, "-pt")) {    // performance test
             PipeTest1();
         } else if (!strcmp(*argv, "-ptt")) {    // performance test
@@ -11,8 +11,9 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	Strict priority scheduling, FIFO within a priority.  A thread that
+//	becomes ready with a better priority than the running thread
+//	preempts it as soon as interrupts are re-enabled.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -21,31 +22,39 @@
 #include "copyright.h"
 #include "scheduler.h"
 #include "system.h"
+#include <strings.h>
 
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
-// 	Initialize the list of ready but not running threads to empty.
+// 	Initialize the lists of ready but not running threads to empty.
 //----------------------------------------------------------------------
 
 Scheduler::Scheduler()
 { 
-    readyList = new List; 
+    for (int i = 0; i < NumPriorities; i++)
+	readyList[i] = new IntrusiveList<Thread>;
+    readyMask = 0;
+    numLevels = 0;
 } 
 
 //----------------------------------------------------------------------
 // Scheduler::~Scheduler
-// 	De-allocate the list of ready threads.
+// 	De-allocate the lists of ready threads.
 //----------------------------------------------------------------------
 
 Scheduler::~Scheduler()
 { 
-    delete readyList; 
+    for (int i = 0; i < NumPriorities; i++)
+	delete readyList[i];
 } 
 
 //----------------------------------------------------------------------
 // Scheduler::ReadyToRun
 // 	Mark a thread as ready, but not running.
-//	Put it on the ready list, for later scheduling onto the CPU.
+//	Put it on the ready list for its priority, for later scheduling
+//	onto the CPU.  A thread that was blocked goes to the front of its
+//	queue.  If it is more urgent than the running thread, arrange for
+//	the running thread to be preempted.
 //
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
@@ -53,23 +62,65 @@ Scheduler::~Scheduler()
 void
 Scheduler::ReadyToRun (Thread *thread)
 {
+    int level = thread->getPriority();
+
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
-    if(thread->getStatus() == BLOCKED){
-        readyList->Prepend((void*)thread);
-        thread->setStatus(READY);
-        return;
+    if (IsMLFQ() && thread->getStatus() == JUST_CREATED) {
+	level = 0;			// new threads start at the top
+	thread->setPriority(0);
     }
+    ASSERT(level >= 0 && level < NumPriorities);
+    if(thread->getStatus() == BLOCKED)
+        readyList[level]->Prepend(thread);
+    else
+        readyList[level]->Append(thread);
+    readyMask |= 1 << level;
     thread->setStatus(READY);
-    /*readyList->SortedInsert((void *)thread, thread->getPriority());
-    if(thread->getPriority() < currentThread->getPriority() && thread->getUID() != 2){
-        currentThread->Yield();
-    }*/
-    readyList->Append((void*)thread);
+
+    if (thread != currentThread && level < currentThread->getPriority()
+			&& currentThread->getStatus() == RUNNING)
+	interrupt->YieldWhenSafe();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetInherited
+// 	Change the priority a thread has inherited from the threads
+//	waiting for its locks.  A ready thread is queued by its effective
+//	priority, so if that changes, move the thread to the queue for
+//	its new priority, and preempt the running thread if need be.
+//
+//	"thread" is a lock holder, not the running thread
+//	"inherited" is the new inherited priority, NoInheritedPriority
+//		if none
+//----------------------------------------------------------------------
+
+void
+Scheduler::SetInherited(Thread *thread, int inherited)
+{
+    int oldLevel = thread->getPriority();
+    int level;
+
+    thread->setInheritedPriority(inherited);
+    level = thread->getPriority();
+    if (thread->getStatus() != READY || level == oldLevel)
+	return;
+
+    DEBUG('t', "Moving thread %s from level %d to %d\n",
+	  thread->getName(), oldLevel, level);
+    readyList[oldLevel]->RemoveItem(thread);
+    if (readyList[oldLevel]->IsEmpty())
+	readyMask &= ~(1 << oldLevel);
+    readyList[level]->Append(thread);
+    readyMask |= 1 << level;
+    if (level < currentThread->getPriority()
+			&& currentThread->getStatus() == RUNNING)
+	interrupt->YieldWhenSafe();
 }
 
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
-// 	Return the next thread to be scheduled onto the CPU.
+// 	Return the next thread to be scheduled onto the CPU: the first
+//	thread in the most urgent non-empty queue.
 //	If there are no ready threads, return NULL.
 // Side effect:
 //	Thread is removed from the ready list.
@@ -78,7 +129,14 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
-    return (Thread *)readyList->Remove();
+    if (readyMask == 0)
+	return NULL;
+
+    int level = ffs(readyMask) - 1;	// lowest set bit
+    Thread *thread = readyList[level]->Remove();
+    if (readyList[level]->IsEmpty())
+	readyMask &= ~(1 << level);
+    return thread;
 }
 
 //----------------------------------------------------------------------
@@ -100,6 +158,12 @@ Scheduler::Run (Thread *nextThread)
 {
     Thread *oldThread = currentThread;
     
+    // a thread that blocks before its quantum is up is probably waiting
+    // for I/O: move it up a level
+    if (IsMLFQ() && oldThread->getStatus() == BLOCKED
+			&& oldThread->getBasePriority() > 0)
+	oldThread->setPriority(oldThread->getBasePriority() - 1);
+    
 #ifdef USER_PROGRAM			// ignore until running user programs 
     if (currentThread->space != NULL) {	// if this thread is a user program,
         currentThread->SaveUserState(); // save the user's CPU registers
@@ -112,6 +176,7 @@ Scheduler::Run (Thread *nextThread)
 
     currentThread = nextThread;		    // switch to the next thread
     currentThread->setStatus(RUNNING);      // nextThread is now running
+    currentThread->setSliceStart(stats->totalTicks);
     
     DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
 	  oldThread->getName(), nextThread->getName());
@@ -151,5 +216,84 @@ void
 Scheduler::Print()
 {
     printf("Ready list contents:\n");
-    readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
+    for (int i = 0; i < NumPriorities; i++)
+	readyList[i]->Mapcar((VoidFunctionPtr) ThreadPrint);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetQuanta
+// 	Turn on multi-level feedback queue scheduling.  Must be called
+//	before any thread but "main" exists, and requires the timer to
+//	interrupt at regular (not random) intervals.
+//
+//	"ticks" -- the quantum of each level, most urgent first
+//	"n" -- the number of levels
+//	"boost" -- ticks between moving every thread back to level 0
+//----------------------------------------------------------------------
+
+void
+Scheduler::SetQuanta(int *ticks, int n, int boost)
+{
+    ASSERT(n > 0 && n <= NumPriorities);
+    for (int i = 0; i < n; i++) {
+	ASSERT(ticks[i] > 0);
+	quantum[i] = ticks[i];
+    }
+    numLevels = n;
+    boostPeriod = boost;
+    lastBoost = stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::TimerTick
+// 	Called from the timer interrupt handler.  If the running thread
+//	has used up the quantum of its level, move it down a level and
+//	make it yield when the handler returns.  Also boost everyone back
+//	to level 0 once per "boostPeriod".
+//----------------------------------------------------------------------
+
+void
+Scheduler::TimerTick()
+{
+    int level = currentThread->getBasePriority();
+
+    if (boostPeriod > 0 && stats->totalTicks - lastBoost >= boostPeriod) {
+	Boost();
+	lastBoost = stats->totalTicks;
+	interrupt->YieldOnReturn();
+	return;
+    }
+    if (level >= numLevels)		// priority set by hand
+	level = numLevels - 1;
+    if (stats->totalTicks - currentThread->getSliceStart() >= quantum[level]) {
+	if (level < numLevels - 1)
+	    level++;
+	DEBUG('t', "Thread \"%s\" used up its quantum, now at level %d\n",
+	      currentThread->getName(), level);
+	currentThread->setPriority(level);
+	interrupt->YieldOnReturn();
+    }
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Boost
+// 	Put every thread at level 0, so that threads starved by a stream
+//	of more urgent ones get to run.  Threads on the ready list keep
+//	their order, level by level.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Boost()
+{
+    Thread *thread;
+
+    DEBUG('t', "Boosting all threads to level 0\n");
+    for (int i = 0; i < threadTable->Size(); i++)
+	if (threadTable->At(i) != NULL)
+	    threadTable->At(i)->setPriority(0);
+    for (int i = 1; i < NumPriorities; i++)
+	while ((thread = readyList[i]->Remove()) != NULL)
+	    readyList[0]->Append(thread);
+    if (readyMask != 0)
+	readyMask = 1;
 }
@@ -11,11 +11,26 @@
 
 #include "copyright.h"
 #include "list.h"
+#include "ilist.h"
 #include "thread.h"
 
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
 // thread is running, and which threads are ready but not running.
+//
+// Ready threads are kept in one FIFO queue per priority, with a bitmap
+// of the queues that are non-empty, so that both putting a thread on
+// the ready list and finding the best one to run take constant time.
+// Priority 0 is the most urgent.
+//
+// Optionally (nachos -mlfq), priorities are managed as a multi-level
+// feedback queue: threads start at level 0, move down a level each
+// time they use up the quantum of their level, move up a level when
+// they block before using it up, and all go back to level 0 every
+// "boostPeriod" ticks so that nothing starves.
+
+#define NumPriorities	32		// one bit of readyMask per level
+#define DefaultBoostPeriod	5000	// ticks between MLFQ priority boosts
 
 class Scheduler {
   public:
@@ -27,10 +42,31 @@ class Scheduler {
 					// list, if any, and return thread.
     void Run(Thread* nextThread);	// Cause nextThread to start running
     void Print();			// Print contents of ready list
+    void SetInherited(Thread *thread, int inherited);
+					// Change the priority "thread" has
+					// inherited through locks, moving it
+					// to its new queue if it is ready
+
+    void SetQuanta(int *ticks, int n, int boost);
+					// Switch to MLFQ scheduling, with
+					// "n" levels of "ticks[i]" each
+    bool IsMLFQ() { return numLevels > 0; }
+    void TimerTick();			// Charge the running thread for a
+					// timer interrupt (MLFQ only)
     
   private:
-    List *readyList;  		// queue of threads that are ready to run,
-				// but not running
+    void Boost();			// Move every thread to level 0
+
+    int numLevels;			// MLFQ levels, 0 if not MLFQ
+    int quantum[NumPriorities];		// ticks allowed at each level
+    int boostPeriod;			// ticks between priority boosts
+    int lastBoost;			// when the last boost happened
+
+    IntrusiveList<Thread> *readyList[NumPriorities];
+					// queues of threads that are ready
+					// to run, but not running
+    unsigned int readyMask;		// bit i set iff readyList[i] is
+					// not empty
 };
 
 #endif // SCHEDULER_H
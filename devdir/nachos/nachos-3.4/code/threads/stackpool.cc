@@ -0,0 +1,151 @@
+// stackpool.cc 
+//	Routines to hand out and recycle thread execution stacks.
+//
+//	A stack from the host is laid out as
+//
+//		[ padding | guard page | stack ... | host pointer ]
+//
+//	where the guard page (if any) is aligned to a host page, and the
+//	host pointer after the end of the stack records what "new"
+//	returned, so the memory can be freed again.  The stack itself
+//	grows down towards the guard page.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "stackpool.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// StackPool::StackPool
+// 	Initialize an empty pool.
+//----------------------------------------------------------------------
+
+StackPool::StackPool(bool guard)
+{
+    guardPages = guard;
+    for (int i = 0; i < MaxStackSizes; i++) {
+	lists[i].words = 0;
+	lists[i].first = NULL;
+	lists[i].numFree = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// StackPool::~StackPool
+// 	Give every free stack back to the host.
+//----------------------------------------------------------------------
+
+StackPool::~StackPool()
+{
+    for (int i = 0; i < MaxStackSizes; i++)
+	while (lists[i].first != NULL) {
+	    FreeStack *stack = lists[i].first;
+
+	    lists[i].first = stack->next;
+	    FreeStackMemory((int *) stack, lists[i].words);
+	}
+}
+
+//----------------------------------------------------------------------
+// StackPool::ListFor
+// 	Return the free list for stacks of "words" words, claiming an
+//	unused one if this is a new size.  NULL if all are taken by other
+//	sizes, in which case the stack isn't pooled.
+//----------------------------------------------------------------------
+
+StackList *
+StackPool::ListFor(int words)
+{
+    for (int i = 0; i < MaxStackSizes; i++)
+	if (lists[i].words == words)
+	    return &lists[i];
+    for (int i = 0; i < MaxStackSizes; i++)
+	if (lists[i].words == 0) {
+	    lists[i].words = words;
+	    return &lists[i];
+	}
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// StackPool::Get
+// 	Return a stack of "words" words, recycled if one is free.
+//----------------------------------------------------------------------
+
+int *
+StackPool::Get(int words)
+{
+    StackList *list = ListFor(words);
+
+    if (list == NULL || list->first == NULL)
+	return NewStack(words);
+
+    FreeStack *stack = list->first;
+    list->first = stack->next;
+    list->numFree--;
+    return (int *) stack;
+}
+
+//----------------------------------------------------------------------
+// StackPool::Put
+// 	Put the stack of a deleted thread on the free list for its size.
+//----------------------------------------------------------------------
+
+void
+StackPool::Put(int *stack, int words)
+{
+    StackList *list = ListFor(words);
+
+    if (list == NULL) {
+	FreeStackMemory(stack, words);
+	return;
+    }
+    FreeStack *free = (FreeStack *) stack;
+    free->next = list->first;
+    list->first = free;
+    list->numFree++;
+}
+
+//----------------------------------------------------------------------
+// StackPool::NewStack
+// 	Get memory for a stack from the host, and protect its guard page.
+//----------------------------------------------------------------------
+
+int *
+StackPool::NewStack(int words)
+{
+    int bytes = words * sizeof(int);
+    int pgSize = guardPages ? HostPageSize() : 0;
+    char *host = new char[2 * pgSize + bytes + sizeof(char *)];
+    char *stack = host;
+
+    if (guardPages) {
+	// first page boundary in the block is the guard; stack follows
+	char *guard = (char *) (((unsigned long) host + pgSize - 1)
+					& ~((unsigned long) pgSize - 1));
+	SetGuardPage(guard, TRUE);
+	stack = guard + pgSize;
+    }
+    *(char **) (stack + bytes) = host;
+    DEBUG('t', "New %d word stack at 0x%x\n", words, (int) stack);
+    return (int *) stack;
+}
+
+//----------------------------------------------------------------------
+// StackPool::FreeStackMemory
+// 	Unprotect the guard page and return the memory to the host.
+//----------------------------------------------------------------------
+
+void
+StackPool::FreeStackMemory(int *stack, int words)
+{
+    int bytes = words * sizeof(int);
+    char *host = *(char **) ((char *) stack + bytes);
+
+    if (guardPages)
+	SetGuardPage((char *) stack - HostPageSize(), FALSE);
+    delete [] host;
+}
@@ -0,0 +1,61 @@
+// stackpool.h
+//	Data structures for recycling thread execution stacks.
+//
+//	Allocating a stack from the host for every Thread::Fork, and
+//	giving it back in ~Thread, costs host system calls each time.
+//	Instead, a finished thread's stack goes onto a free list for its
+//	size, and the next thread to want a stack of that size takes it.
+//
+//	Unless turned off (nachos -noguard), each stack has an inaccessible
+//	host page just below it, so that running off the end of the stack
+//	faults at once instead of corrupting the heap.  The guard page
+//	is set up only when the stack is first made; a recycled stack
+//	keeps its guard, so reuse costs no system calls either way.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef STACKPOOL_H
+#define STACKPOOL_H
+
+#include "copyright.h"
+
+#define MaxStackSizes	4		// different stack sizes pooled
+
+// A stack on a free list.  The link is kept in the stack itself.
+
+class FreeStack {
+  public:
+    FreeStack *next;
+};
+
+// The free stacks of one size.
+
+class StackList {
+  public:
+    int words;				// size of these stacks, 0 if unused
+    FreeStack *first;			// free stacks of this size
+    int numFree;			// how many
+};
+
+class StackPool {
+  public:
+    StackPool(bool guard);		// "guard" -- put a guard page below
+					// each stack
+    ~StackPool();
+
+    int *Get(int words);		// Return a stack of "words" words
+    void Put(int *stack, int words);	// Give it back for reuse
+
+  private:
+    StackList *ListFor(int words);	// Free list for the size, or NULL
+    int *NewStack(int words);		// Get a new stack from the host
+    void FreeStackMemory(int *stack, int words);
+					// Give one back to the host
+
+    StackList lists[MaxStackSizes];
+    bool guardPages;			// put a guard page below each stack?
+};
+
+#endif // STACKPOOL_H
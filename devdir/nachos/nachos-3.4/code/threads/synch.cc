@@ -25,6 +25,22 @@
 #include "synch.h"
 #include "system.h"
 
+//----------------------------------------------------------------------
+// Profile
+// 	Return the profiling record of a synchronization primitive, or
+//	NULL if profiling is off.  The record is looked up the first time
+//	the primitive is used, so that primitives made before Initialize
+//	get one too.
+//----------------------------------------------------------------------
+
+static SynchRecord *
+Profile(SynchRecord **prof, char *name, SynchKind kind)
+{
+    if (*prof == NULL && synchProfiler != NULL)
+	*prof = synchProfiler->Register(name, kind);
+    return *prof;
+}
+
 //----------------------------------------------------------------------
 // Semaphore::Semaphore
 // 	Initialize a semaphore, so that it can be used for synchronization.
@@ -37,7 +53,8 @@ Semaphore::Semaphore(char* debugName, int initialValue)
 {
     name = debugName;
     value = initialValue;
-    queue = new List;
+    queue = new IntrusiveList<Thread>;
+    prof = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -65,13 +82,22 @@ void
 Semaphore::P()
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
+    SynchRecord *rec = Profile(&prof, name, SemaphoreKind);
+    int start = stats->totalTicks;
+    bool slept = FALSE;
     
     while (value == 0) { 			// semaphore not available
-	queue->Append((void *)currentThread);	// so go to sleep
+	queue->Append(currentThread);	// so go to sleep
 	currentThread->Sleep();
+	slept = TRUE;
     } 
     value--; 					// semaphore available, 
 						// consume its value
+    if (rec != NULL) {
+	rec->acquires++;
+	if (slept)
+	    rec->Wait(stats->totalTicks - start);
+    }
     
     (void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
 }
@@ -90,7 +116,7 @@ Semaphore::V()
     Thread *thread;
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
-    thread = (Thread *)queue->Remove();
+    thread = queue->Remove();
     if (thread != NULL)	   // make thread ready, consuming the V immediately
 	scheduler->ReadyToRun(thread);
     value++;
@@ -101,36 +127,137 @@ Semaphore::V()
 // Note -- without a correct implementation of Condition::Wait(), 
 // the test case in the network assignment won't work!
 Lock::Lock(char* debugName) {
-    mutex = new Semaphore(debugName, 1);
     name = debugName;
     holder = NULL;
+    nextHeld = NULL;
+    waiters = new IntrusiveList<Thread>;
+    prof = NULL;
+    acquiredAt = 0;
 }
 
 Lock::~Lock() {
-    delete mutex;
+    delete waiters;
 }
 
+//----------------------------------------------------------------------
+// Lock::Acquire
+// 	Wait until the lock is FREE, then take it.  While waiting, lend
+//	our priority to the holder (see Donate), so that a less urgent
+//	holder can't keep us waiting behind threads of middle priority.
+//----------------------------------------------------------------------
+
 void Lock::Acquire() {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
-    mutex->P();
+    SynchRecord *rec = Profile(&prof, name, LockKind);
+    int start = stats->totalTicks;
+    bool slept = FALSE;
+
+    ASSERT(holder != currentThread);
+    while (holder != NULL) {
+        if (holder->getPriority() > currentThread->getPriority())
+            stats->numPriorityInversions++;
+        currentThread->waitingOn = this;
+        Donate(currentThread->getPriority());
+        waiters->Append(currentThread);
+        currentThread->Sleep();
+        slept = TRUE;
+    }
+    currentThread->waitingOn = NULL;
+    if (rec != NULL) {
+        rec->acquires++;
+        if (slept)
+            rec->Wait(stats->totalTicks - start);
+    }
+    acquiredAt = stats->totalTicks;
     holder = currentThread;
+    nextHeld = holder->heldLocks;
+    holder->heldLocks = this;
     (void) interrupt->SetLevel(oldLevel);
 }
 
+//----------------------------------------------------------------------
+// Lock::Release
+// 	Free the lock and wake the most urgent waiter.  Our inherited
+//	priority goes back to what the waiters for the locks we still
+//	hold justify.
+//----------------------------------------------------------------------
+
 void Lock::Release() {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
-    mutex->V();
+    ASSERT(isHeldByCurrentThread());
+    if (prof != NULL)
+        prof->Hold(stats->totalTicks - acquiredAt);
+
+    Lock **ptr = &currentThread->heldLocks;	// unlink from held list
+    while (*ptr != this)
+        ptr = &(*ptr)->nextHeld;
+    *ptr = nextHeld;
+    nextHeld = NULL;
     holder = NULL;
+
+    Thread *next = NULL;
+    for (Thread *t = waiters->First(); t != NULL; t = t->link.next)
+        if (next == NULL || t->getPriority() < next->getPriority())
+            next = t;
+    if (next != NULL) {
+        waiters->RemoveItem(next);
+        scheduler->ReadyToRun(next);
+    }
+
+    int inherited = NoInheritedPriority;
+    for (Lock *l = currentThread->heldLocks; l != NULL; l = l->nextHeld)
+        if (l->MostUrgentWaiter() < inherited)
+            inherited = l->MostUrgentWaiter();
+    currentThread->setInheritedPriority(inherited);
+    if (next != NULL && currentThread->getPriority() > next->getPriority())
+        interrupt->YieldWhenSafe();
     (void) interrupt->SetLevel(oldLevel);
 }
 
+//----------------------------------------------------------------------
+// Lock::Donate
+// 	Raise the holder of this lock to "priority", if that is more
+//	urgent than what it runs at now.  If the holder is itself waiting
+//	for a lock, pass the priority on to that lock's holder, and so on.
+//	Called with interrupts off.
+//----------------------------------------------------------------------
+
+void Lock::Donate(int priority) {
+    for (Lock *l = this; l != NULL && l->holder != NULL;
+                                        l = l->holder->waitingOn) {
+        if (l->holder->getPriority() <= priority)
+            break;			// already urgent enough
+        DEBUG('t', "Thread %s lends priority %d to %s through lock %s\n",
+              currentThread->getName(), priority, l->holder->getName(),
+              l->name);
+        scheduler->SetInherited(l->holder, priority);
+        stats->numPriorityDonations++;
+    }
+}
+
+//----------------------------------------------------------------------
+// Lock::MostUrgentWaiter
+// 	Return the priority of the most urgent thread waiting for this
+//	lock, or NoInheritedPriority if there are none.
+//----------------------------------------------------------------------
+
+int Lock::MostUrgentWaiter() {
+    int best = NoInheritedPriority;
+
+    for (Thread *t = waiters->First(); t != NULL; t = t->link.next)
+        if (t->getPriority() < best)
+            best = t->getPriority();
+    return best;
+}
+
 bool Lock::isHeldByCurrentThread(){
     return currentThread == holder;
 }
 
 Condition::Condition(char* debugName) {
     name = debugName;
-    waitList = new List;
+    waitList = new IntrusiveList<Thread>;
+    prof = NULL;
 }
 
 Condition::~Condition() {
@@ -140,10 +267,16 @@ Condition::~Condition() {
 void Condition::Wait(Lock* conditionLock) {
     ASSERT(conditionLock->isHeldByCurrentThread() == TRUE);
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
-    waitList->Append((void*)currentThread);
+    SynchRecord *rec = Profile(&prof, name, ConditionKind);
+    int start = stats->totalTicks;
+    waitList->Append(currentThread);
     conditionLock->Release();
     currentThread->Sleep();
     conditionLock->Acquire();
+    if (rec != NULL) {			// a Wait always sleeps
+        rec->acquires++;
+        rec->Wait(stats->totalTicks - start);
+    }
     (void) interrupt->SetLevel(oldLevel);
 }
 
@@ -151,7 +284,7 @@ void Condition::Signal(Lock* conditionLock) {
     ASSERT(conditionLock->isHeldByCurrentThread() == TRUE);
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
     Thread* thread;
-    thread = (Thread *)waitList->Remove();
+    thread = waitList->Remove();
     if (thread != NULL)
         scheduler->ReadyToRun(thread);
     (void) interrupt->SetLevel(oldLevel);
@@ -161,10 +294,10 @@ void Condition::Broadcast(Lock* conditionLock) {
     ASSERT(conditionLock->isHeldByCurrentThread() == TRUE);
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
     Thread* thread;
-    thread = (Thread *)waitList->Remove();
+    thread = waitList->Remove();
     while (thread != NULL){
         scheduler->ReadyToRun(thread);
-        thread = (Thread *)waitList->Remove();
+        thread = waitList->Remove();
     }
     (void) interrupt->SetLevel(oldLevel);
 }
@@ -195,6 +328,159 @@ void Barrier::barrierFunc(){
     lock->Release();
 }
 
+//----------------------------------------------------------------------
+// RWLock::RWLock
+// 	Initialize a readers-writer lock, so that it can be used for
+//	synchronization.  Nobody holds it to start with.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(char* debugName)
+{
+    name = debugName;
+    lock = new Lock(debugName);
+    readOK = new Condition(debugName);
+    writeOK = new Condition(debugName);
+    readers = 0;
+    waitingWriters = 0;
+    writer = NULL;
+    upgrading = FALSE;
+}
+
+RWLock::~RWLock()
+{
+    delete lock;
+    delete readOK;
+    delete writeOK;
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireRead
+// 	Wait until there is no writer, holding or waiting, then join the
+//	readers.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireRead()
+{
+    lock->Acquire();
+    while (writer != NULL || waitingWriters > 0)
+	readOK->Wait(lock);
+    readers++;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseRead
+// 	Leave the readers.  The last one out lets the writers in; all of
+//	them are woken, in case one is a reader waiting in Upgrade.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReleaseRead()
+{
+    lock->Acquire();
+    ASSERT(readers > 0);
+    readers--;
+    if (readers == 0 && waitingWriters > 0)
+	writeOK->Broadcast(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireWrite
+// 	Wait until there are no readers and no writer, and no reader is
+//	upgrading (it goes first), then take the lock for writing.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireWrite()
+{
+    lock->Acquire();
+    ASSERT(writer != currentThread);
+    waitingWriters++;
+    while (writer != NULL || readers > 0 || upgrading)
+	writeOK->Wait(lock);
+    waitingWriters--;
+    writer = currentThread;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseWrite
+// 	Give up the lock to the next writer if there is one, otherwise
+//	to all the waiting readers.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReleaseWrite()
+{
+    lock->Acquire();
+    ASSERT(writer == currentThread);
+    writer = NULL;
+    if (waitingWriters > 0)
+	writeOK->Signal(lock);
+    else
+	readOK->Broadcast(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::Upgrade
+// 	Turn a read hold into a write hold, waiting for the other
+//	readers to leave.  New readers are held off meanwhile, since
+//	we count as a waiting writer.
+//
+//	Two readers upgrading at once would each wait for the other to
+//	leave, so only one may; return FALSE (still reading) to the other.
+//----------------------------------------------------------------------
+
+bool
+RWLock::Upgrade()
+{
+    lock->Acquire();
+    ASSERT(readers > 0);
+    if (upgrading) {
+	lock->Release();
+	return FALSE;
+    }
+    upgrading = TRUE;
+    readers--;
+    waitingWriters++;
+    while (readers > 0)			// no writer can be in: we read
+	writeOK->Wait(lock);
+    waitingWriters--;
+    upgrading = FALSE;
+    writer = currentThread;
+    lock->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// RWLock::Downgrade
+// 	Turn a write hold into a read hold.  Other readers may come in
+//	with us, unless a writer is waiting.
+//----------------------------------------------------------------------
+
+void
+RWLock::Downgrade()
+{
+    lock->Acquire();
+    ASSERT(writer == currentThread);
+    writer = NULL;
+    readers++;
+    if (waitingWriters == 0)
+	readOK->Broadcast(lock);
+    lock->Release();
+}
+
+bool
+RWLock::isWriteHeldByCurrentThread()
+{
+    return writer == currentThread;
+}
+
 readwriteLock::readwriteLock(){
     write = new Semaphore("write", 1);
     mutex = new Semaphore("mutex", 1);
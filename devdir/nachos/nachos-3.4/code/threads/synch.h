@@ -20,6 +20,9 @@
 #include "copyright.h"
 #include "thread.h"
 #include "list.h"
+#include "ilist.h"
+
+class SynchRecord;
 
 // The following class defines a "semaphore" whose value is a non-negative
 // integer.  The semaphore has only two operations P() and V():
@@ -48,7 +51,9 @@ class Semaphore {
   private:
     char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
-    List *queue;       // threads waiting in P() for the value to be > 0
+    IntrusiveList<Thread> *queue;
+		       // threads waiting in P() for the value to be > 0
+    SynchRecord *prof; // contention counts, NULL unless profiling
 };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -62,6 +67,11 @@ class Semaphore {
 // In addition, by convention, only the thread that acquired the lock
 // may release it.  As with semaphores, you can't read the lock value
 // (because the value might change immediately after you read it).  
+//
+// Locks use priority inheritance: while a thread waits in Acquire, the
+// holder runs at the waiter's priority if that is more urgent, and so
+// on down the chain if the holder is itself waiting for a lock.  The
+// holder drops back when it releases the lock.
 
 class Lock {
   public:
@@ -77,11 +87,19 @@ class Lock {
 					// checking in Release, and in
 					// Condition variable ops below.
 
+    Lock *nextHeld;			// next lock held by our holder
+
   private:
     char* name;				// for debugging
-    Semaphore* mutex;
-    Thread* holder;
-    // plus some other stuff you'll need to define
+    Thread* holder;			// NULL if the lock is FREE
+    IntrusiveList<Thread>* waiters;	// threads waiting in Acquire
+    SynchRecord *prof;			// contention counts, NULL unless
+					// profiling
+    int acquiredAt;			// when the holder got the lock
+
+    void Donate(int priority);		// Pass "priority" on to the holder,
+					// and whoever it is waiting for
+    int MostUrgentWaiter();		// Priority of the most urgent waiter
 };
 
 // The following class defines a "condition variable".  A condition
@@ -134,7 +152,9 @@ class Condition {
   private:
     char* name;
     // plus some other stuff you'll need to define
-    List* waitList;
+    IntrusiveList<Thread>* waitList;
+    SynchRecord *prof;			// contention counts, NULL unless
+					// profiling
 };
 
 
@@ -150,6 +170,46 @@ private:
     int num;
 };
 
+// The following class defines a readers-writer lock.  Any number of
+// threads may hold it for reading at once, or one thread for writing.
+//
+// Writers are preferred: once a writer is waiting, new readers wait
+// behind it, so a stream of readers can't starve writers.
+//
+// A reader may Upgrade to a writer without letting go in between,
+// as long as no other reader is already upgrading (Upgrade returns
+// FALSE then, and the caller still holds the lock for reading).  A
+// writer may Downgrade to a reader.
+
+class RWLock {
+  public:
+    RWLock(char* debugName);		// initialize lock to be FREE
+    ~RWLock();				// deallocate lock
+    char* getName() { return name; }	// debugging assist
+
+    void AcquireRead();			// wait until no writer is in or waiting
+    void ReleaseRead();
+    void AcquireWrite();		// wait until nobody else is in
+    void ReleaseWrite();
+
+    bool Upgrade();			// read -> write, FALSE if another
+					// reader is upgrading already
+    void Downgrade();			// write -> read
+
+    bool isWriteHeldByCurrentThread();	// true if the current thread
+					// holds it for writing
+
+  private:
+    char* name;				// for debugging
+    Lock* lock;				// protects the fields below
+    Condition* readOK;			// readers wait here
+    Condition* writeOK;			// writers (and the upgrader) wait here
+    int readers;			// threads holding it for reading
+    int waitingWriters;			// threads waiting to write
+    Thread* writer;			// thread holding it for writing
+    bool upgrading;			// is a reader waiting in Upgrade?
+};
+
 class readwriteLock{
 public:
     readwriteLock();
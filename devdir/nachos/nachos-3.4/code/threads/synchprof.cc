@@ -0,0 +1,175 @@
+// synchprof.cc 
+//	Routines to count and time acquisitions of semaphores, locks and
+//	condition variables, and report on them at the end of the run.
+//
+//	Records are allocated one at a time and never freed until the
+//	end, so a primitive can keep a pointer to its record.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "synchprof.h"
+#include "system.h"
+
+static char *kindNames[] = { "semaphore", "lock", "condition" };
+
+//----------------------------------------------------------------------
+// SynchRecord::Wait
+// 	Count a P, Acquire or Wait that slept for "ticks".
+//----------------------------------------------------------------------
+
+void
+SynchRecord::Wait(int ticks)
+{
+    int bucket = 0;
+
+    contended++;
+    totalWait += ticks;
+    if (ticks > maxWait)
+	maxWait = ticks;
+    while (bucket < WaitBuckets - 1 && ticks >= (1 << bucket))
+	bucket++;
+    waitHist[bucket]++;
+}
+
+//----------------------------------------------------------------------
+// SynchRecord::Hold
+// 	Count a Lock that was held for "ticks".
+//----------------------------------------------------------------------
+
+void
+SynchRecord::Hold(int ticks)
+{
+    totalHold += ticks;
+    if (ticks > maxHold)
+	maxHold = ticks;
+}
+
+//----------------------------------------------------------------------
+// SynchProfiler::SynchProfiler
+// 	Start with no records.
+//
+//	"csvFile" -- UNIX file to write the records to at the end, or NULL
+//----------------------------------------------------------------------
+
+SynchProfiler::SynchProfiler(char *csvFile)
+{
+    maxRecords = InitialSynchRecords;
+    records = new SynchRecord *[maxRecords];
+    numRecords = 0;
+    csvName = csvFile;
+}
+
+SynchProfiler::~SynchProfiler()
+{
+    for (int i = 0; i < numRecords; i++)
+	delete records[i];
+    delete [] records;
+}
+
+//----------------------------------------------------------------------
+// SynchProfiler::Register
+// 	Return the record for primitives of kind "kind" named "name",
+//	making one if this is the first.
+//----------------------------------------------------------------------
+
+SynchRecord *
+SynchProfiler::Register(char *name, SynchKind kind)
+{
+    if (name == NULL)
+	name = "(unnamed)";
+    for (int i = 0; i < numRecords; i++)
+	if (records[i]->kind == kind && !strcmp(records[i]->name, name))
+	    return records[i];
+
+    if (numRecords == maxRecords) {		// full, double it
+	SynchRecord **bigger = new SynchRecord *[maxRecords * 2];
+
+	for (int i = 0; i < numRecords; i++)
+	    bigger[i] = records[i];
+	delete [] records;
+	records = bigger;
+	maxRecords *= 2;
+    }
+    SynchRecord *rec = new SynchRecord;
+    rec->name = name;
+    rec->kind = kind;
+    rec->acquires = rec->contended = 0;
+    rec->totalWait = rec->maxWait = 0;
+    rec->totalHold = rec->maxHold = 0;
+    for (int i = 0; i < WaitBuckets; i++)
+	rec->waitHist[i] = 0;
+    records[numRecords++] = rec;
+    return rec;
+}
+
+//----------------------------------------------------------------------
+// SynchProfiler::Print
+// 	Print a line for every record that was used, most contended
+//	first.
+//----------------------------------------------------------------------
+
+void
+SynchProfiler::Print()
+{
+    bool *printed = new bool[numRecords];
+
+    for (int i = 0; i < numRecords; i++)
+	printed[i] = FALSE;
+    printf("Synchronization: kind name acquires contended "
+	   "wait(total/max) hold(total/max)\n");
+    for (;;) {
+	int best = -1;
+
+	for (int i = 0; i < numRecords; i++)
+	    if (!printed[i] && records[i]->acquires > 0 && (best == -1
+			|| records[i]->totalWait > records[best]->totalWait))
+		best = i;
+	if (best == -1)
+	    break;
+	printed[best] = TRUE;
+
+	SynchRecord *rec = records[best];
+	printf("  %s \"%s\" %d %d %d/%d %d/%d\n", kindNames[rec->kind],
+	       rec->name, rec->acquires, rec->contended, rec->totalWait,
+	       rec->maxWait, rec->totalHold, rec->maxHold);
+    }
+    delete [] printed;
+}
+
+//----------------------------------------------------------------------
+// SynchProfiler::WriteCSV
+// 	Write every record to the CSV file, one per line, with the wait
+//	histogram in the last columns.
+//----------------------------------------------------------------------
+
+void
+SynchProfiler::WriteCSV()
+{
+    FILE *fp;
+
+    if (csvName == NULL)
+	return;
+    if ((fp = fopen(csvName, "w")) == NULL) {
+	printf("Can't write lock profile to %s\n", csvName);
+	return;
+    }
+    fprintf(fp, "kind,name,acquires,contended,total_wait,max_wait,"
+		"total_hold,max_hold");
+    for (int b = 0; b < WaitBuckets - 1; b++)
+	fprintf(fp, ",wait_lt_%d", 1 << b);
+    fprintf(fp, ",wait_longer\n");
+    for (int i = 0; i < numRecords; i++) {
+	SynchRecord *rec = records[i];
+
+	fprintf(fp, "%s,\"%s\",%d,%d,%d,%d,%d,%d", kindNames[rec->kind],
+		rec->name, rec->acquires, rec->contended, rec->totalWait,
+		rec->maxWait, rec->totalHold, rec->maxHold);
+	for (int b = 0; b < WaitBuckets; b++)
+	    fprintf(fp, ",%d", rec->waitHist[b]);
+	fprintf(fp, "\n");
+    }
+    fclose(fp);
+}
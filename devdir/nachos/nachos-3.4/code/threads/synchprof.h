@@ -0,0 +1,67 @@
+// synchprof.h
+//	Data structures for profiling contention on synchronization
+//	primitives.
+//
+//	Turned on with "nachos -lp" (or "-lp file.csv" to also write the
+//	numbers out as CSV).  Each Semaphore, Lock and Condition is
+//	charged to a record for its debug name, so all the mailbox locks,
+//	say, show up as one line.  Times are in simulated ticks.
+//
+//	For every record we keep:
+//		acquires -- number of P / Acquire / Wait calls
+//		contended -- how many of those had to sleep
+//		wait -- total and largest time spent asleep, and a
+//			histogram of it in powers of two
+//		hold -- total and largest time a Lock was held
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SYNCHPROF_H
+#define SYNCHPROF_H
+
+#include "copyright.h"
+#include "utility.h"
+
+enum SynchKind { SemaphoreKind, LockKind, ConditionKind };
+
+#define WaitBuckets	16		// histogram bucket i counts waits
+					// of less than 2^i ticks; the last
+					// one counts everything longer
+#define InitialSynchRecords 32		// records to start with
+
+// The counts for every primitive of one kind with one name.
+
+class SynchRecord {
+  public:
+    char *name;
+    SynchKind kind;
+    int acquires;			// P, Acquire or Wait calls
+    int contended;			// ... that had to sleep
+    int totalWait, maxWait;		// ticks spent asleep
+    int totalHold, maxHold;		// ticks a Lock was held
+    int waitHist[WaitBuckets];		// waits, by log2 of their length
+
+    void Wait(int ticks);		// Charge a wait of "ticks"
+    void Hold(int ticks);		// Charge a hold of "ticks"
+};
+
+class SynchProfiler {
+  public:
+    SynchProfiler(char *csvFile);	// "csvFile" may be NULL
+    ~SynchProfiler();
+
+    SynchRecord *Register(char *name, SynchKind kind);
+					// Record for primitives named "name"
+    void Print();			// Print the records that were used
+    void WriteCSV();			// Write them all to csvFile
+
+  private:
+    SynchRecord **records;
+    int numRecords;
+    int maxRecords;			// size of "records"
+    char *csvName;
+};
+
+#endif // SYNCHPROF_H
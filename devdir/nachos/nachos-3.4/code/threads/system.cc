@@ -19,9 +19,9 @@ Statistics *stats;			// performance metrics
 Timer *timer;				// the hardware timer device,
 					// for invoking context switches
 
-int threadNum;
-Thread* myThreads[maxThreadNum];
-int ThreadExit[maxThreadNum];
+ThreadTable *threadTable;
+StackPool *stackPool;
+SynchProfiler *synchProfiler;
 
 #ifdef FILESYS_NEEDED
 FileSystem  *fileSystem;
@@ -29,10 +29,16 @@ FileSystem  *fileSystem;
 
 #ifdef FILESYS
 SynchDisk   *synchDisk;
+InodeTable  *inodeTable;	// headers of the files in use
 #endif
 
 #ifdef USER_PROGRAM	// requires either FILESYS or FILESYS_STUB
 Machine *machine;	// user program memory and registers
+AsyncIO *asyncIO;	// asynchronous file I/O requests
+PipeTable *pipeTable;	// in-memory pipes
+ShmTable *shmTable;	// shared memory segments
+SemTable *semTable;	// user semaphores
+FutexTable *futexTable;	// futex waiters
 #endif
 
 #ifdef NETWORK
@@ -64,10 +70,34 @@ extern void Cleanup();
 static void
 TimerInterruptHandler(int dummy)
 {
-    if (interrupt->getStatus() != IdleMode)
+    if (interrupt->getStatus() == IdleMode)
+	return;
+    if (scheduler->IsMLFQ())
+	scheduler->TimerTick();		// yield only when the quantum is up
+    else
 	interrupt->YieldOnReturn();
 }
 
+//----------------------------------------------------------------------
+// ParseQuanta
+// 	Turn a comma separated list of tick counts ("100,200,400") into
+//	the quanta for each MLFQ level.  Return the number of levels.
+//----------------------------------------------------------------------
+static int
+ParseQuanta(char *list, int *quanta)
+{
+    int n = 0;
+
+    while (*list != '\0' && n < NumPriorities) {
+	quanta[n++] = atoi(list);
+	while (*list != '\0' && *list != ',')
+	    list++;
+	if (*list == ',')
+	    list++;
+    }
+    return n;
+}
+
 //----------------------------------------------------------------------
 // Initialize
 // 	Initialize Nachos global data structures.  Interpret command
@@ -81,14 +111,17 @@ TimerInterruptHandler(int dummy)
 void
 Initialize(int argc, char **argv)
 {
-    threadNum = 0;
-    for(int i=0; i<maxThreadNum; ++i){
-        myThreads[i] = NULL;
-    }
+    threadTable = new ThreadTable();
     
     int argCount;
     char* debugArgs = "";
     bool randomYield = FALSE;
+    int quanta[NumPriorities];		// MLFQ quantum of each level
+    int numLevels = 0;			// 0 unless -mlfq was given
+    int boostPeriod = DefaultBoostPeriod;
+    bool guardStacks = TRUE;		// guard page below each stack
+    bool profileSynch = FALSE;		// count lock contention?
+    char *profileFile = NULL;		// CSV file for the counts
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
@@ -96,6 +129,10 @@ Initialize(int argc, char **argv)
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
 #endif
+#ifdef FILESYS
+    int cacheBuffers = cacheNum;	// sectors in the buffer cache
+    DiskPolicy diskPolicy = DiskCSCAN;	// order of queued disk requests
+#endif
 #ifdef NETWORK
     double rely = 1;		// network reliability
     int netname = 0;		// UNIX socket name
@@ -116,6 +153,22 @@ Initialize(int argc, char **argv)
 						// number generator
 	    randomYield = TRUE;
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-mlfq")) {
+	    ASSERT(argc > 1);
+	    numLevels = ParseQuanta(*(argv + 1), quanta);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-boost")) {
+	    ASSERT(argc > 1);
+	    boostPeriod = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-noguard")) {
+	    guardStacks = FALSE;
+	} else if (!strcmp(*argv, "-lp")) {
+	    profileSynch = TRUE;
+	    if (argc > 1 && argv[1][0] != '-') {	// -lp <csv file>
+		profileFile = *(argv + 1);
+		argCount = 2;
+	    }
 	}
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
@@ -125,6 +178,27 @@ Initialize(int argc, char **argv)
 	if (!strcmp(*argv, "-f"))
 	    format = TRUE;
 #endif
+#ifdef FILESYS
+	if (!strcmp(*argv, "-cb")) {
+	    ASSERT(argc > 1);
+	    cacheBuffers = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-ds")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "fifo"))
+		diskPolicy = DiskFIFO;
+	    else if (!strcmp(*(argv + 1), "sstf"))
+		diskPolicy = DiskSSTF;
+	    else if (!strcmp(*(argv + 1), "cscan"))
+		diskPolicy = DiskCSCAN;
+	    else {
+		printf("Unknown disk policy \"%s\"; "
+		       "usage: -ds fifo|sstf|cscan\n", *(argv + 1));
+		Exit(1);
+	    }
+	    argCount = 2;
+	}
+#endif
 #ifdef NETWORK
 	if (!strcmp(*argv, "-l")) {
 	    ASSERT(argc > 1);
@@ -141,9 +215,15 @@ Initialize(int argc, char **argv)
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
     interrupt = new Interrupt;			// start up interrupt handling
+    stackPool = new StackPool(guardStacks);	// before any thread is forked
+    if (profileSynch)
+	synchProfiler = new SynchProfiler(profileFile);
     scheduler = new Scheduler();		// initialize the ready queue
-    if (randomYield)				// start the timer (if needed)
-	timer = new Timer(TimerInterruptHandler, 0, randomYield);
+    if (numLevels > 0)				// MLFQ, with a steady timer
+	scheduler->SetQuanta(quanta, numLevels, boostPeriod);
+    if (randomYield || numLevels > 0)		// start the timer (if needed)
+	timer = new Timer(TimerInterruptHandler, 0,
+			  randomYield && numLevels == 0);
 
     threadToBeDestroyed = NULL;
 
@@ -152,6 +232,8 @@ Initialize(int argc, char **argv)
     // object to save its state. 
     currentThread = new Thread("main");		
     currentThread->setStatus(RUNNING);
+    if (numLevels > 0)
+	currentThread->setPriority(0);
 
     interrupt->Enable();
     CallOnUserAbort(Cleanup);			// if user hits ctl-C
@@ -161,13 +243,22 @@ Initialize(int argc, char **argv)
 #endif
 
 #ifdef FILESYS
-    synchDisk = new SynchDisk("DISK");
+    synchDisk = new SynchDisk("DISK", cacheBuffers, diskPolicy);
+    inodeTable = new InodeTable();
 #endif
 
 #ifdef FILESYS_NEEDED
     fileSystem = new FileSystem(format);
 #endif
 
+#ifdef USER_PROGRAM
+    asyncIO = new AsyncIO();
+    pipeTable = new PipeTable();
+    shmTable = new ShmTable();
+    semTable = new SemTable();
+    futexTable = new FutexTable();
+#endif
+
 #ifdef NETWORK
     postOffice = new PostOffice(netname, rely, 10);
 #endif
@@ -182,11 +273,20 @@ void
 Cleanup()
 {
     printf("\nCleaning up...\n");
+    if (synchProfiler != NULL) {
+	synchProfiler->Print();
+	synchProfiler->WriteCSV();
+    }
 #ifdef NETWORK
     delete postOffice;
 #endif
     
 #ifdef USER_PROGRAM
+    delete futexTable;
+    delete semTable;
+    delete shmTable;
+    delete pipeTable;
+    delete asyncIO;
     delete machine;
 #endif
 
@@ -195,6 +295,7 @@ Cleanup()
 #endif
 
 #ifdef FILESYS
+    delete inodeTable;
     delete synchDisk;
 #endif
     
@@ -206,10 +307,10 @@ Cleanup()
 }
 
 void TS(){
-    printf("There are %d threads listed below:\n", threadNum);
-    for(int i=0; i<maxThreadNum; ++i){
-        if(myThreads[i] != NULL){
-            myThreads[i]->myPrint();
+    printf("There are %d threads listed below:\n", threadTable->Count());
+    for(int i=0; i<threadTable->Size(); ++i){
+        if(threadTable->At(i) != NULL){
+            threadTable->At(i)->myPrint();
         }
     }
 }
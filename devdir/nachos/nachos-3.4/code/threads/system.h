@@ -15,6 +15,9 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#include "threadtable.h"
+#include "stackpool.h"
+#include "synchprof.h"
 
 // Initialization and cleanup routines
 extern void Initialize(int argc, char **argv); 	// Initialization,
@@ -29,14 +32,22 @@ extern Interrupt *interrupt;			// interrupt status
 extern Statistics *stats;			// performance metrics
 extern Timer *timer;				// the hardware alarm clock
 
-extern int threadNum;
-extern Thread* myThreads[maxThreadNum];
+extern ThreadTable *threadTable;		// every thread, by thread id
+extern StackPool *stackPool;			// stacks of finished threads
+extern SynchProfiler *synchProfiler;		// lock contention counts,
+						// NULL unless -lp was given
 extern void TS();
-extern int ThreadExit[maxThreadNum];
 
 #ifdef USER_PROGRAM
 #include "machine.h"
+#include "asyncio.h"
+#include "pipe.h"
 extern Machine* machine;	// user program memory and registers
+extern AsyncIO* asyncIO;	// outstanding AsyncRead/AsyncWrite requests
+extern PipeTable* pipeTable;	// in-memory pipes between user programs
+extern ShmTable* shmTable;	// shared memory segments
+extern SemTable* semTable;	// semaphores for user programs
+extern FutexTable* futexTable;	// threads waiting in FutexWait
 #endif
 
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB 
@@ -46,7 +57,9 @@ extern FileSystem  *fileSystem;
 
 #ifdef FILESYS
 #include "synchdisk.h"
+#include "inode.h"
 extern SynchDisk   *synchDisk;
+extern InodeTable  *inodeTable;
 #endif
 
 #ifdef NETWORK
@@ -19,6 +19,9 @@
 #include "switch.h"
 #include "synch.h"
 #include "system.h"
+#ifdef USER_PROGRAM
+#include "syscall.h"
+#endif
 
 #define STACK_FENCEPOST 0xdeadbeef	// this is put at the top of the
 					// execution stack, for detecting 
@@ -34,33 +37,25 @@
 
 Thread::Thread(char* threadName)
 {
-    int flag = 1;
-    if(threadNum >= maxThreadNum){
-        printf("WRONG : Thread limit exceeded!\n");
-        flag = 0;
-    }
-    
-    ASSERT(flag == 1);
-    
-    for(int i=0; i<maxThreadNum; ++i){
-        if(myThreads[i] == NULL){
-            this->setTID(i);
-            myThreads[i] = this;
-            threadNum++;
-            break;
-        }
-    }
+    this->setTID(threadTable->Add(this));
     
     name = threadName;
     stackTop = NULL;
     stack = NULL;
+    stackSize = StackSize;
     status = JUST_CREATED;
     
     priority = 15;
+    inheritedPriority = NoInheritedPriority;
+    waitingOn = NULL;
+    heldLocks = NULL;
+    sliceStart = 0;
     
     UID = 0;
 #ifdef USER_PROGRAM
     space = NULL;
+    stdIn = ConsoleInput;
+    stdOut = ConsoleOutput;
     
     UID = 1;
 #endif
@@ -68,33 +63,25 @@ Thread::Thread(char* threadName)
 
 Thread::Thread(char* threadName, int x)
 {
-    int flag = 1;
-    if(threadNum > maxThreadNum){
-        printf("WRONG : Thread limit exceeded!\n");
-        flag = 0;
-    }
-    
-    ASSERT(flag == 1);
-    
-    for(int i=0; i<maxThreadNum; ++i){
-        if(myThreads[i] == NULL){
-            this->setTID(i);
-            myThreads[i] = this;
-            threadNum++;
-            break;
-        }
-    }
+    this->setTID(threadTable->Add(this));
     
     name = threadName;
     stackTop = NULL;
     stack = NULL;
+    stackSize = StackSize;
     status = JUST_CREATED;
     
     priority = Random() % 15;
+    inheritedPriority = NoInheritedPriority;
+    waitingOn = NULL;
+    heldLocks = NULL;
+    sliceStart = 0;
     
     UID = 0;
 #ifdef USER_PROGRAM
     space = NULL;
+    stdIn = ConsoleInput;
+    stdOut = ConsoleOutput;
     
     UID = 1;
 #endif
@@ -118,7 +105,7 @@ Thread::~Thread()
 
     ASSERT(this != currentThread);
     if (stack != NULL)
-	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+	stackPool->Put(stack, stackSize);	// keep it for the next thread
 }
 
 //----------------------------------------------------------------------
@@ -175,7 +162,7 @@ Thread::CheckOverflow()
 {
     if (stack != NULL)
 #ifdef HOST_SNAKE			// Stacks grow upward on the Snakes
-	ASSERT(stack[StackSize - 1] == STACK_FENCEPOST);
+	ASSERT(stack[stackSize - 1] == STACK_FENCEPOST);
 #else
 	ASSERT((int) *stack == (int) STACK_FENCEPOST);
 #endif
@@ -206,8 +193,7 @@ Thread::Finish ()
     DEBUG('t', "Finishing thread \"%s\"\n", getName());
     
     //recycling thread
-    threadNum--;
-    myThreads[this->getTID()] = NULL;
+    threadTable->Remove(this->getTID());
     
     threadToBeDestroyed = currentThread;
     Sleep();                    // invokes SWITCH
@@ -314,19 +300,19 @@ void ThreadPrint(int arg){ Thread *t = (Thread *)arg; t->Print(); }
 void
 Thread::StackAllocate (VoidFunctionPtr func, int arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+    stack = stackPool->Get(stackSize);
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
     stackTop = stack + 16;	// HP requires 64-byte frame marker
-    stack[StackSize - 1] = STACK_FENCEPOST;
+    stack[stackSize - 1] = STACK_FENCEPOST;
 #else
     // i386 & MIPS & SPARC stack works from high addresses to low addresses
 #ifdef HOST_SPARC
     // SPARC stack must contains at least 1 activation record to start with.
-    stackTop = stack + StackSize - 96;
+    stackTop = stack + stackSize - 96;
 #else  // HOST_MIPS  || HOST_i386
-    stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
+    stackTop = stack + stackSize - 4;	// -4 to be on the safe side!
 #ifdef HOST_i386
     // the 80386 passes the return address on the stack.  In order for
     // SWITCH() to go to ThreadRoot when we switch to this thread, the
@@ -39,6 +39,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "ilist.h"
 
 #ifdef USER_PROGRAM
 #include "machine.h"
@@ -55,12 +56,15 @@
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 #define StackSize	(4 * 1024)	// in words
 
-#define maxThreadNum 128
-
 
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED, SUSPENDED };
 
+// Inherited priority of a thread that holds no lock anyone is waiting for
+#define NoInheritedPriority	0x7fffffff
+
+class Lock;
+
 // external function, dummy routine whose sole job is to call Thread::Print
 extern void ThreadPrint(int arg);	 
 
@@ -84,6 +88,9 @@ class Thread {
     int UID;   //UserID
     int TID;   //ThreadID
     int priority;
+    int inheritedPriority;	// most urgent priority of a thread waiting
+				// for a lock we hold (maybe indirectly)
+    int sliceStart;	// stats->totalTicks when last dispatched
 
   public:
     Thread(char* debugName);		// initialize a Thread 
@@ -125,10 +132,28 @@ class Thread {
         }
     }
     
-    int getPriority() { return this->priority; }
+    int getPriority() { return inheritedPriority < priority ?
+				inheritedPriority : priority; }
+					// priority we are scheduled at
+    int getBasePriority() { return this->priority; }
     void setPriority(int pp) { this->priority = pp; }
+    void setInheritedPriority(int pp) { inheritedPriority = pp; }
+					// Use Scheduler::SetInherited, which
+					// also moves a ready thread
+
+    Lock *waitingOn;			// lock we are blocked in Acquire for
+    Lock *heldLocks;			// locks we hold, linked by nextHeld
+    
+    int getSliceStart() { return this->sliceStart; }
+    void setSliceStart(int t) { this->sliceStart = t; }
     
     void setName(char *nn){ name = nn; }
+
+    ListLink<Thread> link;		// on the ready list, or the wait
+					// queue of a Semaphore or Condition
+    void setStackSize(int words) { ASSERT(stack == NULL); stackSize = words; }
+					// Size (in words) of the stack Fork
+					// will give the thread
     
     ThreadStatus exStatus;
 
@@ -138,6 +163,7 @@ class Thread {
     int* stack; 	 		// Bottom of the stack 
 					// NULL if this is the main thread
 					// (If NULL, don't deallocate stack)
+    int stackSize;			// size of the stack, in words
     ThreadStatus status;		// ready, running or blocked
     char* name;
 
@@ -155,8 +181,14 @@ class Thread {
   public:
     void SaveUserState();		// save user-level register state
     void RestoreUserState();		// restore user-level register state
+    void SetUserRegister(int num, int value)
+	{ userRegisters[num] = value; }	// set up a new program's registers
 
     AddrSpace *space;			// User code this thread is running.
+
+    int stdIn;				// what ConsoleInput refers to:
+    int stdOut;				// ConsoleInput/ConsoleOutput for the
+					// console itself, or a pipe end
 #endif
 };
 
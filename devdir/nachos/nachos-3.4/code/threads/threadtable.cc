@@ -0,0 +1,150 @@
+// threadtable.cc 
+//	Routines to allocate thread ids, and to find a thread from its id.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "threadtable.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// ThreadTable::ThreadTable
+// 	Initialize an empty table, with every slot on the free list.
+//----------------------------------------------------------------------
+
+ThreadTable::ThreadTable()
+{
+    size = 0;
+    count = 0;
+    slots = NULL;
+    freeHead = freeTail = -1;
+    Grow();
+}
+
+ThreadTable::~ThreadTable()
+{
+    delete [] slots;
+}
+
+//----------------------------------------------------------------------
+// ThreadTable::Grow
+// 	Double the size of the table, and put the new slots at the end
+//	of the free list.
+//----------------------------------------------------------------------
+
+void
+ThreadTable::Grow()
+{
+    int newSize = (size == 0) ? InitialThreadSlots : size * 2;
+    ThreadSlot *newSlots = new ThreadSlot[newSize];
+
+    ASSERT(newSize <= SlotMask + 1);
+    for (int i = 0; i < size; i++)
+	newSlots[i] = slots[i];
+    for (int i = size; i < newSize; i++) {
+	newSlots[i].thread = NULL;
+	newSlots[i].generation = 0;
+	newSlots[i].exitStatus = 0;
+	newSlots[i].nextFree = (i + 1 < newSize) ? i + 1 : -1;
+    }
+    if (freeTail == -1)
+	freeHead = size;
+    else
+	newSlots[freeTail].nextFree = size;
+    freeTail = newSize - 1;
+
+    delete [] slots;
+    slots = newSlots;
+    DEBUG('t', "Thread table grown from %d to %d slots\n", size, newSize);
+    size = newSize;
+}
+
+//----------------------------------------------------------------------
+// ThreadTable::Add
+// 	Take the slot at the head of the free list for "thread", and
+//	return the id that names it.
+//----------------------------------------------------------------------
+
+int
+ThreadTable::Add(Thread *thread)
+{
+    if (freeHead == -1)
+	Grow();
+
+    int slot = freeHead;
+    freeHead = slots[slot].nextFree;
+    if (freeHead == -1)
+	freeTail = -1;
+
+    slots[slot].thread = thread;
+    slots[slot].exitStatus = 0;
+    count++;
+    return (slots[slot].generation << SlotBits) | slot;
+}
+
+//----------------------------------------------------------------------
+// ThreadTable::Remove
+// 	Release the slot of the thread named "tid", and put it at the end
+//	of the free list.  The exit status stays until the slot is reused.
+//----------------------------------------------------------------------
+
+void
+ThreadTable::Remove(int tid)
+{
+    int slot = tid & SlotMask;
+
+    ASSERT(Find(tid) != NULL);
+    slots[slot].thread = NULL;
+    slots[slot].generation = (slots[slot].generation + 1) & GenerationMask;
+    slots[slot].nextFree = -1;
+    if (freeTail == -1)
+	freeHead = slot;
+    else
+	slots[freeTail].nextFree = slot;
+    freeTail = slot;
+    count--;
+}
+
+//----------------------------------------------------------------------
+// ThreadTable::Find
+// 	Return the thread named by "tid", if it still exists.
+//----------------------------------------------------------------------
+
+Thread *
+ThreadTable::Find(int tid)
+{
+    int slot = tid & SlotMask;
+
+    if (tid < 0 || slot >= size
+	    || slots[slot].generation != ((tid >> SlotBits) & GenerationMask))
+	return NULL;
+    return slots[slot].thread;
+}
+
+//----------------------------------------------------------------------
+// ThreadTable::SetExitStatus
+// ThreadTable::GetExitStatus
+// 	Record the status a thread exited with, and fetch it back for
+//	Join.  Since Remove bumps the generation, a finished thread's id
+//	is one generation behind its slot.
+//----------------------------------------------------------------------
+
+void
+ThreadTable::SetExitStatus(int tid, int status)
+{
+    ASSERT(Find(tid) != NULL);
+    slots[tid & SlotMask].exitStatus = status;
+}
+
+int
+ThreadTable::GetExitStatus(int tid)
+{
+    int slot = tid & SlotMask;
+
+    if (tid < 0 || slot >= size || slots[slot].thread != NULL
+	    || slots[slot].generation != (((tid >> SlotBits) + 1) & GenerationMask))
+	return -1;
+    return slots[slot].exitStatus;
+}
@@ -0,0 +1,67 @@
+// threadtable.h
+//	Data structures for finding threads by thread id.
+//
+//	A thread id is a handle: the index of the thread's slot in the
+//	table, plus the slot's generation number, which goes up each time
+//	the slot is reused.  So an id held on to after its thread is gone
+//	can never be mistaken for a newer thread that got the same slot.
+//
+//	Free slots are kept on a FIFO free list, so allocating and
+//	releasing an id is constant time and a slot is reused as late as
+//	possible.  The table doubles in size when it runs out of slots;
+//	there is no fixed limit on the number of threads.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef THREADTABLE_H
+#define THREADTABLE_H
+
+#include "copyright.h"
+
+#define SlotBits	20		// low bits of an id: the slot
+#define SlotMask	((1 << SlotBits) - 1)
+#define GenerationMask	0x7ff		// rest of the id (kept positive)
+#define InitialThreadSlots	128	// the table grows from here
+
+class Thread;
+
+// One slot of the table.
+
+class ThreadSlot {
+  public:
+    Thread *thread;			// NULL if the slot is free
+    int generation;			// bumped each time the slot is reused
+    int exitStatus;			// status of the last thread to use it
+    int nextFree;			// next slot on the free list, or -1
+};
+
+class ThreadTable {
+  public:
+    ThreadTable();
+    ~ThreadTable();
+
+    int Add(Thread *thread);		// Give "thread" a slot; return its id
+    void Remove(int tid);		// The thread is finished with its slot
+
+    Thread *Find(int tid);		// The thread with id "tid", or NULL if
+					// it has finished (or never existed)
+    void SetExitStatus(int tid, int status);
+    int GetExitStatus(int tid);		// Status passed to Exit, as long as
+					// the slot hasn't been reused; else -1
+
+    int Count() { return count; }	// Number of threads that exist
+    int Size() { return size; }		// Number of slots, for iterating
+    Thread *At(int slot) { return slots[slot].thread; }
+
+  private:
+    void Grow();			// Double the number of slots
+
+    ThreadSlot *slots;
+    int size;				// number of slots
+    int count;				// slots in use
+    int freeHead, freeTail;		// FIFO list of free slots
+};
+
+#endif // THREADTABLE_H
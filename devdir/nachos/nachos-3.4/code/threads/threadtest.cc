@@ -12,6 +12,7 @@
 #include "copyright.h"
 #include "system.h"
 #include "synch.h"
+#include <time.h>
 //#include "elevatortest.h"
 
 // testnum is set in main.cc
@@ -111,7 +112,7 @@ void ThreadTest3(){
     }
     currentThread->Yield();
     TS();
-    printf("Threads now:%d\n", threadNum);
+    printf("Threads now:%d\n", threadTable->Count());
     printf("FINISH TEST FINISHED\n\n");
 }
 
@@ -302,6 +303,135 @@ void ThreadTest10(){
     t1->Fork(SimpleThread4, 1);
 }
 
+//create many short-lived threads, more than ever fit in the old fixed
+//table, and check that the id of a finished thread isn't found again
+//after its slot has been reused
+void ThreadTest11(){
+    int first = -1;
+    for(int i=0; i<20000; ++i){
+        Thread* t = new Thread("short-lived");
+        if(first == -1)
+            first = t->getTID();
+        t->Fork(myFinish, i);
+        if(i % 100 == 99)
+            currentThread->Yield();
+    }
+    currentThread->Yield();
+    ASSERT(threadTable->Find(first) == NULL);
+    printf("Threads now:%d, table size %d\n", threadTable->Count(), threadTable->Size());
+}
+
+//microbenchmark for the pending interrupt queue: keep "devices"
+//events outstanding, each of which schedules the next one for its
+//device when it fires, until a million have fired.  The time per
+//event should stay about flat as the number of devices grows
+static int benchFired;
+static int benchDevices;
+static PendingInterrupt **benchEvents;	//next event of each device
+
+static void benchEvent(int device){
+    benchFired++;
+    benchEvents[device] = interrupt->Schedule(benchEvent, device,
+            1 + Random() % (benchDevices * SystemTick), DiskInt);
+}
+
+void ThreadTest12(){
+    const int total = 1000000;
+    for(int devices=1; devices<=100000; devices*=10){
+        benchEvents = new PendingInterrupt *[devices];
+        benchFired = 0;
+        benchDevices = devices;
+        for(int i=0; i<devices; ++i)
+            benchEvents[i] = interrupt->Schedule(benchEvent, i,
+                    1 + Random() % (devices * SystemTick), DiskInt);
+        clock_t start = clock();
+        while(benchFired < total)
+            interrupt->OneTick();
+        double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+        //take back the events still outstanding, so the next round
+        //starts clean
+        IntStatus oldLevel = interrupt->SetLevel(IntOff);
+        for(int i=0; i<devices; ++i)
+            interrupt->Cancel(benchEvents[i]);
+        (void) interrupt->SetLevel(oldLevel);
+        printf("%6d devices: %d events in %.3f s, %.0f ns/event\n",
+               devices, benchFired, secs, secs * 1e9 / benchFired);
+        delete [] benchEvents;
+    }
+}
+
+//priority inversion: "low" holds a lock that "high" needs, while
+//"middle" is ready to run.  "low" inherits high's priority, so it
+//gets to finish with the lock before "middle" runs at all
+Lock* inversionLock;
+
+void highWaiter(int which){
+    inversionLock->Acquire();
+    printf("%s got the lock\n", currentThread->getName());
+    inversionLock->Release();
+}
+
+void middleSpinner(int which){
+    for(int i=0; i<3; ++i){
+        printf("%s is running\n", currentThread->getName());
+        interrupt->OneTick();
+    }
+}
+
+void lowHolder(int which){
+    inversionLock->Acquire();
+    Thread* t = new Thread("high");
+    t->setPriority(1);
+    t->Fork(highWaiter, 1);
+    Thread* t1 = new Thread("middle");
+    t1->setPriority(5);
+    t1->Fork(middleSpinner, 1);
+    for(int i=0; i<3; ++i){
+        printf("%s holds the lock at priority %d\n", currentThread->getName(), currentThread->getPriority());
+        interrupt->OneTick();
+    }
+    inversionLock->Release();
+    printf("%s released the lock, back to priority %d\n", currentThread->getName(), currentThread->getPriority());
+}
+
+void ThreadTest13(){
+    inversionLock = new Lock("inversion lock");
+    Thread* t = new Thread("low");
+    t->setPriority(10);
+    t->Fork(lowHolder, 1);
+}
+
+//writer preference: the writer forked after the first two readers
+//gets in before the two readers forked after it
+RWLock* fairLock;
+
+void rwReader(int which){
+    fairLock->AcquireRead();
+    printf("reader %d is reading\n", which);
+    currentThread->Yield();
+    fairLock->ReleaseRead();
+}
+
+void rwWriter(int which){
+    fairLock->AcquireWrite();
+    printf("writer %d is writing\n", which);
+    currentThread->Yield();
+    fairLock->Downgrade();
+    printf("writer %d is now reading\n", which);
+    fairLock->ReleaseRead();
+}
+
+void ThreadTest14(){
+    fairLock = new RWLock("fair rwlock");
+    for(int i=0; i<5; ++i){
+        Thread* t = new Thread("rw");
+        if(i == 2)
+            t->Fork(rwWriter, i);
+        else
+            t->Fork(rwReader, i);
+    }
+}
+
 void
 ThreadTest()
 {
@@ -333,6 +463,18 @@ ThreadTest()
         case 10:
             ThreadTest10();
             break;
+        case 11:
+            ThreadTest11();
+            break;
+        case 12:
+            ThreadTest12();
+            break;
+        case 13:
+            ThreadTest13();
+            break;
+        case 14:
+            ThreadTest14();
+            break;
         default:
             printf("No test specified.\n");
             break;
@@ -49,6 +49,16 @@ AddrSpace::AddrSpace(AddrSpace *space){
     numPages = space->numPages;
     pageTable = new TranslationEntry[numPages];
     space->copyPageTable(pageTable);
+    for (int i = 0; i < MaxShmAttach; i++)
+        shmIds[i] = -1;
+    for (int i = 0; i < MaxOpenIds; i++)
+        openIds[i] = -1;
+    for (int i = 0; i < MaxUserThreads; i++) {
+        stackTops[i] = 0;
+        stackOwners[i] = -1;
+    }
+    threadExited = new Semaphore("thread exited", 0);
+    joinWaiters = 0;
 }
 
 
@@ -73,6 +83,16 @@ AddrSpace::AddrSpace(OpenFile *executable)
     unsigned int i, size;
     
     progMap = new BitMap(NumPhysPages);
+    for (i = 0; i < MaxShmAttach; i++)
+        shmIds[i] = -1;
+    for (i = 0; i < MaxOpenIds; i++)
+        openIds[i] = -1;
+    for (i = 0; i < MaxUserThreads; i++) {
+        stackTops[i] = 0;
+        stackOwners[i] = -1;
+    }
+    threadExited = new Semaphore("thread exited", 0);
+    joinWaiters = 0;
 
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) && 
@@ -154,6 +174,7 @@ AddrSpace::~AddrSpace()
 {
     delete pageTable;
     delete progMap;
+    delete threadExited;
 }
 
 //----------------------------------------------------------------------
@@ -201,12 +222,9 @@ void AddrSpace::SaveState() {
         machine->tlb[i].valid = FALSE;
         machine->LRUtime[i] = 0;
     }
-    
-    for(int i=0; i<NumPhysPages; ++i){
-        if(progMap->Test(i)){
-            machine->pageBelong[i] = currentThread->getTID();
-        }
-    }
+    // machine->pageBelong names the address space, set when a page
+    // comes in, so nothing to stamp here: the thread switched out may
+    // be one of several sharing this space, and may be exiting
 }
 
 //----------------------------------------------------------------------
@@ -228,7 +246,7 @@ void AddrSpace::clearMap(){
         if(progMap->Test(i)){
             machine->memoryMap->Clear(i);
             progMap->Clear(i);
-            machine->pageBelong[i] = -1;
+            machine->pageBelong[i] = NULL;
             //printf("%s:physical page %d cleared..\n", currentThread->getName(), i);
             for(int j=0; j<NumPhysPages; ++j){
                 if(machine->memoryMap->Test(j) &&
@@ -243,8 +261,8 @@ void AddrSpace::clearMap(){
     //clear swapArea
     int numm = 0;
     for(int i=0; i<machine->swapNum; ++i){
-        if(machine->swapArea[i].tid == currentThread->getTID()){
-            machine->swapArea[i].tid = -1;
+        if(machine->swapArea[i].space == this){
+            machine->swapArea[i].space = NULL;
             machine->swapArea[i].vpn = -1;
             numm++;
         }
@@ -252,19 +270,254 @@ void AddrSpace::clearMap(){
     for(int i=1; i<machine->swapNum; ++i){
         int t = i;
         while(t!=0){
-            if(machine->swapArea[t-1].tid == -1 && machine->swapArea[t].tid != -1){
+            if(machine->swapArea[t-1].space == NULL && machine->swapArea[t].space != NULL){
                 machine->swapArea[t-1] = machine->swapArea[t];
+                machine->swapArea[t].space = NULL;
+                machine->swapArea[t].vpn = -1;
                 t = t-1;
             }
             else
                 break;
         }
-        machine->swapArea[i].tid = -1;
-        machine->swapArea[i].vpn = -1;
     }
     machine->swapNum -= numm;
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::Preload
+// 	Bring pages in ahead of time, for a program about to be started,
+//	so that it doesn't begin with a page fault on
+//	every page it touches.  The top of the stack goes first (the
+//	arguments are copied there), then the program from page 0 up.
+//	Only free frames are used; anything that doesn't fit is left to
+//	be paged in on demand as usual.
+//----------------------------------------------------------------------
+
+void AddrSpace::Preload(OpenFile *executable){
+    NoffHeader noffH;
+    executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
+    if ((noffH.noffMagic != NOFFMAGIC) &&
+        (WordToHost(noffH.noffMagic) == NOFFMAGIC))
+        SwapHeader(&noffH);
+    ASSERT(noffH.noffMagic == NOFFMAGIC);
+    
+    unsigned int fileEnd = divRoundUp(noffH.code.size + noffH.initData.size, PageSize);
+    for(unsigned int n=0; n<numPages; ++n){
+        unsigned int vpn = (n == 0) ? numPages - 1 : n - 1;
+        if(pageTable[vpn].valid)
+            continue;
+        int t = machine->memoryMap->Find();
+        if(t == -1)
+            break;
+        for(int j=0; j<NumPhysPages; ++j){
+            if(machine->memoryMap->Test(j) && j != t)
+                machine->pageLRUtime[j]++;
+        }
+        machine->pageLRUtime[t] = 0;
+        
+        int physAddr = t * PageSize;
+        if(vpn < fileEnd){
+            int readAddr = noffH.code.inFileAddr + vpn * PageSize;
+            executable->ReadAt(&(machine->mainMemory[physAddr]), PageSize, readAddr);
+        }
+        else
+            bzero(&(machine->mainMemory[physAddr]), PageSize);
+        
+        pageTable[vpn].physicalPage = t;
+        pageTable[vpn].valid = TRUE;
+        pageTable[vpn].use = FALSE;
+        pageTable[vpn].readOnly = FALSE;
+        pageTable[vpn].dirty = FALSE;
+        machine->pageBelong[t] = this;
+        progMap->Mark(t);
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WriteUser
+// 	Copy "n" bytes to virtual address "addr" of this address space,
+//	which need not be the one loaded into the machine.  A page that
+//	isn't resident is written into the swap area for this address
+//	space, where dealWithPageFault will find it.
+//----------------------------------------------------------------------
+
+void AddrSpace::WriteUser(int addr, char *from, int n){
+    for(int i=0; i<n; ++i){
+        int vpn = (unsigned)(addr+i) / PageSize;
+        int offset = (unsigned)(addr+i) % PageSize;
+        ASSERT((unsigned) vpn < numPages);
+        if(pageTable[vpn].valid){
+            machine->mainMemory[pageTable[vpn].physicalPage * PageSize + offset] = from[i];
+            continue;
+        }
+        int k;
+        for(k=0; k<machine->swapNum; ++k){
+            if(machine->swapArea[k].space == this && machine->swapArea[k].vpn == vpn)
+                break;
+        }
+        if(k == machine->swapNum){
+            ASSERT(machine->swapNum < swapPageNum);
+            machine->swapArea[k].space = this;
+            machine->swapArea[k].vpn = vpn;
+            bzero(machine->swapArea[k].page, PageSize);
+            machine->swapNum++;
+        }
+        machine->swapArea[k].page[offset] = from[i];
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Grow
+// 	Extend the page table by "n" pages, not yet in memory, and
+//	return the virtual page number of the first.
+//----------------------------------------------------------------------
+
+int AddrSpace::Grow(int n){
+    TranslationEntry *newTable = new TranslationEntry[numPages + n];
+    int first = numPages;
+    
+    copyPageTable(newTable);
+    for(int i=first; i<first+n; ++i){
+        newTable[i].virtualPage = i;
+        newTable[i].physicalPage = -1;
+        newTable[i].valid = FALSE;
+        newTable[i].use = FALSE;
+        newTable[i].dirty = FALSE;
+        newTable[i].readOnly = FALSE;
+    }
+    delete [] pageTable;
+    pageTable = newTable;
+    numPages += n;
+    
+    if(currentThread->space == this)
+        RestoreState();
+    return first;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocThreadStack
+// 	Find a stack region for user thread "tid", reusing one left by a
+//	thread that has exited or else adding pages to the end of the
+//	address space (they are paged in on demand like the rest).
+//	Return the initial stack pointer, or -1 if there are already
+//	MaxUserThreads threads.
+//----------------------------------------------------------------------
+
+int AddrSpace::AllocThreadStack(int tid){
+    for(int i=0; i<MaxUserThreads; ++i){
+        if(stackOwners[i] != -1)
+            continue;
+        if(stackTops[i] == 0){
+            int first = Grow(divRoundUp(ThreadStackSize, PageSize));
+            stackTops[i] = numPages * PageSize - 16;
+            DEBUG('a', "New thread stack at pages %d-%d\n", first, numPages - 1);
+        }
+        stackOwners[i] = tid;
+        return stackTops[i];
+    }
+    return -1;
+}
+
+void AddrSpace::FreeThreadStack(int tid){
+    for(int i=0; i<MaxUserThreads; ++i){
+        if(stackOwners[i] == tid)
+            stackOwners[i] = -1;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::JoinThread
+// 	Sleep until thread "tid" of this address space has exited, and
+//	return its exit status.  Every exiting thread wakes all waiters,
+//	who check again; interrupts are off from the check until the
+//	sleep, so that an exit in between can't be missed.
+//----------------------------------------------------------------------
+
+int AddrSpace::JoinThread(int tid){
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    
+    while(threadTable->Find(tid) != NULL){
+        joinWaiters++;
+        threadExited->P();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return threadTable->GetExitStatus(tid);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ThreadExiting
+// 	Wake every thread in JoinThread.  Interrupts must be off, and
+//	stay off through Thread::Finish, so that the waiters don't run
+//	before the exiting thread has left the thread table.
+//----------------------------------------------------------------------
+
+void AddrSpace::ThreadExiting(){
+    ASSERT(interrupt->getLevel() == IntOff);
+    for(; joinWaiters > 0; joinWaiters--)
+        threadExited->V();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapShared
+// 	Grow the address space by "n" pages, mapped onto the physical
+//	pages in "frames" (a shared memory segment).  The new pages go
+//	above the stack, and are always valid, so they never page fault.
+//	Return the virtual address of the first one.
+//----------------------------------------------------------------------
+
+int AddrSpace::MapShared(int *frames, int n){
+    int first = Grow(n);
+    
+    for(int i=0; i<n; ++i){
+        pageTable[first+i].physicalPage = frames[i];
+        pageTable[first+i].valid = TRUE;
+    }
+    return first * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::UnmapShared
+// 	Remove the "n" shared pages mapped at "addr", and flush them out
+//	of the TLB.  The pages are marked UnmappedPage, so that touching
+//	them is an address error rather than a page fault that reads in
+//	the executable.  Only unmapped pages at the end of the page table
+//	are cut off; the addresses of other attached segments, and of
+//	thread stacks, don't change.
+//----------------------------------------------------------------------
+
+void AddrSpace::UnmapShared(int addr, int n){
+    int first = addr / PageSize;
+    
+    for(int i=first; i<first+n; ++i){
+        pageTable[i].valid = FALSE;
+        pageTable[i].physicalPage = UnmappedPage;
+    }
+    while(numPages > 0 && pageTable[numPages-1].physicalPage == UnmappedPage)
+        numPages--;
+    if(currentThread->space == this)
+        RestoreState();
+    if(currentThread->space == this){
+        for(int i=0; i<TLBSize; ++i){
+            if(machine->tlb[i].valid && machine->tlb[i].virtualPage >= first
+               && machine->tlb[i].virtualPage < first + n)
+                machine->tlb[i].valid = FALSE;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsMapped
+// 	Return whether "virtAddr" lies in a page of this address space
+//	that may be paged in: inside the page table, and not left behind
+//	by UnmapShared.
+//----------------------------------------------------------------------
+
+bool AddrSpace::IsMapped(int virtAddr){
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    
+    return vpn < numPages && pageTable[vpn].physicalPage != UnmappedPage;
+}
+
 void AddrSpace::LoadByByte(OpenFile *executable){
     NoffHeader noffH;
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
@@ -324,11 +577,11 @@ void AddrSpace::dealWithPageFault(){
         t = machine->pageLRUReplace();
         //printf("no empty physical page and replace physical page %d\n", t);
         //update origin thread
-        int tid = machine->pageBelong[t];
-        myThreads[tid]->space->progMap->Clear(t);
+        AddrSpace *victim = machine->pageBelong[t];
+        victim->progMap->Clear(t);
         
         NoffHeader noffH;
-        OpenFile *executable1 = fileSystem->Open(myThreads[tid]->space->filename);
+        OpenFile *executable1 = fileSystem->Open(victim->filename);
         executable1->ReadAt((char *)&noffH, sizeof(noffH), 0);
         if ((noffH.noffMagic != NOFFMAGIC) &&
             (WordToHost(noffH.noffMagic) == NOFFMAGIC))
@@ -336,16 +589,16 @@ void AddrSpace::dealWithPageFault(){
         ASSERT(noffH.noffMagic == NOFFMAGIC);
         
         int vv = -1;
-        for(int i=0; i<myThreads[tid]->space->numPages; ++i){
-            if((myThreads[tid]->space->pageTable[i].valid) && (myThreads[tid]->space->pageTable[i].physicalPage == t)){
+        for(int i=0; i<victim->numPages; ++i){
+            if((victim->pageTable[i].valid) && (victim->pageTable[i].physicalPage == t)){
                 vv = i;
                 break;
             }
         }
         physAddr = t * PageSize;
-        myThreads[tid]->space->pageTable[vv].valid = FALSE;
-        myThreads[tid]->space->pageTable[vv].physicalPage = -1;
-        if(tid == currentThread->getTID()){
+        victim->pageTable[vv].valid = FALSE;
+        victim->pageTable[vv].physicalPage = -1;
+        if(victim == currentThread->space){
             for(int i=0; i<TLBSize; ++i){
                 if(machine->tlb[i].virtualPage == vv){
                     machine->tlb[i].valid = FALSE;
@@ -359,7 +612,7 @@ void AddrSpace::dealWithPageFault(){
                 }
             }
         }
-        if(myThreads[tid]->space->pageTable[vv].dirty){
+        if(victim->pageTable[vv].dirty){
             printf("write back\n");
             
             int writeAddr = noffH.code.inFileAddr + vv * PageSize;
@@ -369,7 +622,7 @@ void AddrSpace::dealWithPageFault(){
         //put in swapArea
         int ff = 0;
         for(int i=0; i<machine->swapNum; ++i){
-            if(machine->swapArea[i].tid == tid && machine->swapArea[i].vpn == vv){
+            if(machine->swapArea[i].space == victim && machine->swapArea[i].vpn == vv){
                 ff = 1;
                 for(int j=0; j<PageSize; ++j){
                     machine->swapArea[i].page[j] = machine->mainMemory[physAddr+j];
@@ -379,7 +632,8 @@ void AddrSpace::dealWithPageFault(){
         
         if(ff == 0){
             int nn = machine->swapNum;
-            machine->swapArea[nn].tid = tid;
+            ASSERT(nn < swapPageNum);
+            machine->swapArea[nn].space = victim;
             machine->swapArea[nn].vpn = vv;
             for(int j=0; j<PageSize; ++j){
                 machine->swapArea[nn].page[j] = machine->mainMemory[physAddr+j];
@@ -405,7 +659,7 @@ void AddrSpace::dealWithPageFault(){
     //get from swapArea if swapArea has the page
     int fg = 0;
     for(int i=0; i<machine->swapNum; ++i){
-        if(machine->swapArea[i].tid == currentThread->getTID()
+        if(machine->swapArea[i].space == this
            && machine->swapArea[i].vpn == vpn){
             fg = 1;
             for(int j=0; j<PageSize; ++j){
@@ -414,16 +668,15 @@ void AddrSpace::dealWithPageFault(){
         }
     }
     
+    //pages past the code and data (the stacks, including ones grown
+    //for ThreadCreate) are not in the executable: they start zeroed
     if(fg == 0){
-        //if(virtAddr < noffH.code.size + noffH.initData.size){
+        if(vpn < (unsigned) divRoundUp(noffH.code.size + noffH.initData.size, PageSize)){
             int readAddr = noffH.code.inFileAddr + vpn * PageSize;
             executable->ReadAt(&(machine->mainMemory[physAddr]), PageSize, readAddr);
-        //}
-    
-        /*if(virtAddr >= noffH.code.size + noffH.initData.size){
-            for(int i=0; i<PageSize; ++i)
-                machine->mainMemory[physAddr+i] = 0;
-        }*/
+        }
+        else
+            bzero(&(machine->mainMemory[physAddr]), PageSize);
     }
     
     delete executable;
@@ -433,7 +686,7 @@ void AddrSpace::dealWithPageFault(){
     pageTable[vpn].use = FALSE;
     pageTable[vpn].readOnly = FALSE;
     pageTable[vpn].dirty = FALSE;
-    machine->pageBelong[t] = currentThread->getTID();
+    machine->pageBelong[t] = this;
     progMap->Mark(t);
 }
 
@@ -472,13 +725,14 @@ void AddrSpace::Suspend(){
 void AddrSpace::Resume(int t){
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
     
-    char *filename = myThreads[t]->getName();
+    Thread *thread = threadTable->Find(t);
+    char *filename = thread->getName();
     OpenFile *executable = fileSystem->Open(filename);
     //put in swapArea
     for(int i=0; i<numPages; ++i){
         if(pageTable[i].physicalPage == -2){
             int nn = machine->swapNum;
-            machine->swapArea[nn].tid = t;
+            machine->swapArea[nn].space = this;
             machine->swapArea[nn].vpn = i;
             executable->ReadAt(machine->swapArea[i].page, PageSize, i*PageSize);
             machine->swapNum++;
@@ -487,10 +741,10 @@ void AddrSpace::Resume(int t){
     
     printf("%s:resume thread %d\n", currentThread->getName(), t);
     
-    myThreads[t]->setStatus(myThreads[t]->exStatus);
-    if(myThreads[t]->getStatus() != BLOCKED){
-        printf("%s:thread %d go to readyList\n", myThreads[t]->getName(), t);
-        scheduler->ReadyToRun(myThreads[t]);
+    thread->setStatus(thread->exStatus);
+    if(thread->getStatus() != BLOCKED){
+        printf("%s:thread %d go to readyList\n", thread->getName(), t);
+        scheduler->ReadyToRun(thread);
     }
     
     delete executable;
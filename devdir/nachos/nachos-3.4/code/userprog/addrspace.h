@@ -15,8 +15,16 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "ipc.h"
+
+class Semaphore;
 
 #define UserStackSize		1024 	// increase this as necessary!
+#define ThreadStackSize		512	// stack of each ThreadCreate thread
+#define MaxUserThreads		8	// ThreadCreate stacks per program
+#define MaxOpenIds		16	// files and pipe ends open at once
+#define UnmappedPage		(-3)	// physicalPage of a page left
+					// behind by UnmapShared
 
 class AddrSpace {
   public:
@@ -40,6 +48,36 @@ class AddrSpace {
     void dealWithPageFault();
     void Suspend();
     void Resume(int t);
+
+    void Preload(OpenFile *executable);	// Load as many pages as there
+					// are free frames
+    void WriteUser(int addr, char *from, int n);
+					// Copy into the (maybe not yet
+					// resident) memory of this space
+
+    int Grow(int n);			// Add "n" invalid pages to the end
+					// of the page table
+    int AllocThreadStack(int tid);	// Give thread "tid" a stack region,
+					// return its initial stack pointer
+    void FreeThreadStack(int tid);	// Its region can now be reused
+    int stackTops[MaxUserThreads];	// each region (0 if not made yet)
+    int stackOwners[MaxUserThreads];	// thread using it, -1 if free
+
+    int JoinThread(int tid);		// Wait for thread "tid" of this
+					// space to exit; return its status
+    void ThreadExiting();		// Wake the threads in JoinThread;
+					// called with interrupts off, just
+					// before Thread::Finish
+
+    int MapShared(int *frames, int n);	// Append "n" shared frames to the
+					// page table, return their address
+    void UnmapShared(int addr, int n);	// Invalidate them again
+    bool IsMapped(int virtAddr);	// May "virtAddr" be paged in?
+    int shmIds[MaxShmAttach];		// attached segments (-1 if none)
+    int shmAddrs[MaxShmAttach];		// and where each is mapped
+
+    int openIds[MaxOpenIds];		// files and pipe ends this program
+					// has open, closed by Exit (-1 if none)
     
     void copyPageTable(TranslationEntry *to){
         for(int i = 0; i < numPages; i++){
@@ -53,10 +91,19 @@ class AddrSpace {
     }
     
 
+    Semaphore *threadExited;		// JoinThread waits here
+    int joinWaiters;			// threads waiting on it
+
     TranslationEntry *pageTable;	// Assume linear page table translation
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
 };
 
+extern int ReadUserWord(int addr, int size);	// Read/write the current
+extern void WriteUserWord(int addr, int size, int value);
+						// program's memory, faulting
+						// the page in if need be
+						// (in exception.cc)
+
 #endif // ADDRSPACE_H
@@ -0,0 +1,317 @@
+// asyncio.cc
+//	Routines to run file transfers on behalf of a user program without
+//	blocking it.
+//
+//	Each request is given to its own kernel thread, which calls the
+//	ordinary OpenFile::ReadAt/WriteAt and so blocks in SynchDisk until
+//	the disk interrupt completes the transfer.  The thread that issued
+//	the request is free to go on running user code; it later picks up
+//	the result with Poll or WaitAny.
+//
+//	Start yields once the worker is forked, so that the worker gets as
+//	far as waiting for the disk before the user program goes on; Poll
+//	yields while the request is pending, so that a program polling in
+//	a loop lets the worker finish.
+//
+//	The request table is shared by all user programs and protected
+//	by a lock; "ioDone" is broadcast whenever any request finishes, and
+//	WaitAny re-checks for one of its own.
+
+#include "copyright.h"
+#include "system.h"
+#include "asyncio.h"
+
+//----------------------------------------------------------------------
+// AsyncWorker
+// 	Body of the kernel thread that performs one request.  Need this
+//	to be a C routine, because C++ can't handle pointers to member
+//	functions.
+//----------------------------------------------------------------------
+
+static void
+AsyncWorker(int id)
+{
+    asyncIO->Complete(id);
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::AsyncIO
+// 	Initialize the table of asynchronous requests to empty.
+//----------------------------------------------------------------------
+
+AsyncIO::AsyncIO()
+{
+    for (int i = 0; i < MaxAsyncRequests; i++) {
+	table[i].inUse = FALSE;
+	table[i].buffer = NULL;
+    }
+    lock = new Lock("async io lock");
+    ioDone = new Condition("async io done");
+}
+
+AsyncIO::~AsyncIO()
+{
+    for (int i = 0; i < MaxAsyncRequests; i++)
+	if (table[i].buffer != NULL)
+	    delete [] table[i].buffer;
+    delete lock;
+    delete ioDone;
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::Submit
+// 	Allocate a request slot for a transfer at the current position of
+//	"file", and advance that position as a synchronous Read/Write
+//	would.  Return the request id, or -1 if no slot is free.
+//
+//	"file" -- the open file
+//	"userAddr" -- the user buffer, in the caller's address space
+//	"size" -- the number of bytes to transfer
+//	"writing" -- TRUE for AsyncWrite
+//----------------------------------------------------------------------
+
+int
+AsyncIO::Submit(OpenFile *file, int userAddr, int size, bool writing)
+{
+    int id = -1;
+
+    if (file == NULL || size < 0)
+	return -1;
+
+    lock->Acquire();
+    for (int i = 0; i < MaxAsyncRequests; i++)
+	if (!table[i].inUse) {
+	    id = i;
+	    break;
+	}
+    if (id != -1) {
+	AsyncRequest *req = &table[id];
+	int position = file->getPosition();
+
+	if (!writing) {			// reads stop at end of file
+	    if (position + size > file->Length())
+		size = file->Length() - position;
+	    if (size < 0)
+		size = 0;
+	}
+	file->setPosition(position + size);
+
+	req->inUse = TRUE;
+	req->done = FALSE;
+	req->writing = writing;
+	req->owner = currentThread;
+	req->file = file;
+	req->closeFile = FALSE;
+	req->position = position;
+	req->size = size;
+	req->result = 0;
+	req->buffer = new char[size + 1];
+	req->userAddr = userAddr;
+    }
+    lock->Release();
+    return id;
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::Start
+// 	Fork the kernel thread that carries out request "id", and let it
+//	run until it has to wait for the disk.
+//----------------------------------------------------------------------
+
+void
+AsyncIO::Start(int id)
+{
+    Thread *worker = new Thread("async io");
+
+    DEBUG('f', "Starting async %s request %d, %d bytes at %d\n",
+	  table[id].writing ? "write" : "read", id, table[id].size,
+	  table[id].position);
+    worker->Fork(AsyncWorker, id);
+    currentThread->Yield();
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::Complete
+// 	Do the transfer for request "id" (waiting for the disk in the
+//	process), then mark it done and wake up anyone in WaitAny.  If
+//	the file was closed meanwhile, and this was its last request in
+//	flight, close it now.
+//----------------------------------------------------------------------
+
+void
+AsyncIO::Complete(int id)
+{
+    AsyncRequest *req = &table[id];
+    OpenFile *closing = NULL;
+    int result;
+
+    if (req->writing)
+	result = req->file->WriteAt(req->buffer, req->size, req->position);
+    else
+	result = req->file->ReadAt(req->buffer, req->size, req->position);
+
+    lock->Acquire();
+    req->result = result;
+    req->done = TRUE;
+    if (req->closeFile && !InFlight(req->file))
+	closing = req->file;
+    if (req->owner == NULL) {		// nobody is left to collect it
+	delete [] req->buffer;
+	req->buffer = NULL;
+	req->inUse = FALSE;
+    }
+    ioDone->Broadcast(lock);
+    lock->Release();
+    if (closing != NULL)
+	delete closing;
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::Poll
+// 	Check on request "id" without waiting for it.  Return AsyncBadId
+//	if it isn't one of ours, and AsyncPending, after giving up the
+//	CPU, if it is still in flight; otherwise retire it and return the
+//	number of bytes transferred.
+//----------------------------------------------------------------------
+
+int
+AsyncIO::Poll(int id)
+{
+    int result;
+
+    if (id < 0 || id >= MaxAsyncRequests)
+	return AsyncBadId;
+
+    lock->Acquire();
+    if (!table[id].inUse || table[id].owner != currentThread)
+	result = AsyncBadId;
+    else if (!table[id].done)
+	result = AsyncPending;
+    else {
+	result = table[id].result;
+	Retire(id);
+    }
+    lock->Release();
+    if (result == AsyncPending)
+	currentThread->Yield();		// let the worker get on with it
+    return result;
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::WaitAny
+// 	Block until one of the current thread's requests has finished,
+//	retire it, and return its id.  The number of bytes transferred
+//	is stored in "*result".  Return -1 at once if the thread has no
+//	requests outstanding.
+//----------------------------------------------------------------------
+
+int
+AsyncIO::WaitAny(int *result)
+{
+    int id;
+
+    lock->Acquire();
+    for (;;) {
+	bool pending = FALSE;
+
+	id = -1;
+	for (int i = 0; i < MaxAsyncRequests; i++) {
+	    if (!table[i].inUse || table[i].owner != currentThread)
+		continue;
+	    pending = TRUE;
+	    if (table[i].done) {
+		id = i;
+		break;
+	    }
+	}
+	if (id != -1 || !pending)
+	    break;
+	ioDone->Wait(lock);
+    }
+    if (id != -1) {
+	*result = table[id].result;
+	Retire(id);
+    }
+    lock->Release();
+    return id;
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::ThreadExit
+// 	Thread "t" is exiting.  Free its finished requests, and let the
+//	worker threads free the ones still in flight.
+//----------------------------------------------------------------------
+
+void
+AsyncIO::ThreadExit(Thread *t)
+{
+    lock->Acquire();
+    for (int i = 0; i < MaxAsyncRequests; i++) {
+	if (!table[i].inUse || table[i].owner != t)
+	    continue;
+	table[i].owner = NULL;
+	if (table[i].done) {
+	    delete [] table[i].buffer;
+	    table[i].buffer = NULL;
+	    table[i].inUse = FALSE;
+	}
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::CloseFile
+// 	The user program has closed "file".  If requests on it are still
+//	in flight, leave it to the last of them to close (see Complete),
+//	and return TRUE; otherwise return FALSE, and the caller closes it.
+//----------------------------------------------------------------------
+
+bool
+AsyncIO::CloseFile(OpenFile *file)
+{
+    bool deferred = FALSE;
+
+    lock->Acquire();
+    for (int i = 0; i < MaxAsyncRequests; i++)
+	if (table[i].inUse && table[i].file == file && !table[i].done) {
+	    table[i].closeFile = TRUE;
+	    deferred = TRUE;
+	}
+    lock->Release();
+    return deferred;
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::InFlight
+// 	Return TRUE if a request on "file" hasn't finished yet.  Called
+//	with "lock" held.
+//----------------------------------------------------------------------
+
+bool
+AsyncIO::InFlight(OpenFile *file)
+{
+    for (int i = 0; i < MaxAsyncRequests; i++)
+	if (table[i].inUse && table[i].file == file && !table[i].done)
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// AsyncIO::Retire
+// 	Copy the data for a finished read out to the user buffer, and
+//	free the slot.  Must be called by the owner (so that its page
+//	table is the one loaded), with "lock" held.
+//----------------------------------------------------------------------
+
+void
+AsyncIO::Retire(int id)
+{
+    AsyncRequest *req = &table[id];
+
+    if (!req->writing)
+	for (int i = 0; i < req->result; i++)
+	    WriteUserWord(req->userAddr + i, 1, (int) req->buffer[i]);
+    delete [] req->buffer;
+    req->buffer = NULL;
+    req->inUse = FALSE;
+}
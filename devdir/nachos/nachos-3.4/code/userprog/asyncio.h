@@ -0,0 +1,88 @@
+// asyncio.h
+//	Data structures for asynchronous file I/O requested by user programs.
+//
+//	AsyncRead/AsyncWrite return a request id right away.  The transfer
+//	is carried out by a kernel worker thread, which sleeps in SynchDisk
+//	until the disk interrupt says the sector is done; the user program
+//	keeps running in the meantime.  Completion is collected later with
+//	Poll (non-blocking) or WaitAny (blocking).
+//
+//	Data for a read is staged in a kernel buffer and copied out to
+//	user memory when the request is retired, because only the owning
+//	thread has its page table loaded into the machine.
+//
+//	A request in flight keeps its OpenFile alive: a Close of the file
+//	meanwhile is put off until the last of its requests completes.
+
+#ifndef ASYNCIO_H
+#define ASYNCIO_H
+
+#include "copyright.h"
+#include "openfile.h"
+#include "synch.h"
+
+#define MaxAsyncRequests	32	// outstanding requests, system wide
+
+#define AsyncPending	-1		// Poll: the request is still in flight
+#define AsyncBadId	-2		// Poll: no such request of ours
+
+// One asynchronous read or write.
+
+class AsyncRequest {
+  public:
+    bool inUse;				// is this slot allocated?
+    bool done;				// has the transfer finished?
+    bool writing;			// AsyncWrite if TRUE, AsyncRead if FALSE
+    Thread *owner;			// thread that issued the request,
+					// NULL if it exited before completion
+    OpenFile *file;			// file to transfer to/from
+    bool closeFile;			// closed while in flight: delete
+					// "file" after the last request
+    int position;			// file offset of the transfer
+    int size;				// bytes requested
+    int result;				// bytes actually transferred
+    char *buffer;			// kernel staging buffer
+    int userAddr;			// user buffer (virtual address)
+};
+
+// The table of outstanding requests, and the worker threads that
+// complete them.
+
+class AsyncIO {
+  public:
+    AsyncIO();
+    ~AsyncIO();
+
+    int Submit(OpenFile *file, int userAddr, int size, bool writing);
+					// Start a transfer, return its id
+					// (-1 if the table is full).  For a
+					// write, the caller must fill in
+					// Buffer(id) before calling Start.
+    char *Buffer(int id) { return table[id].buffer; }
+    void Start(int id);			// Hand the request to a worker thread
+
+    int Poll(int id);			// AsyncPending if still in flight,
+					// AsyncBadId if "id" isn't ours,
+					// otherwise retire the request and
+					// return the bytes transferred
+    int WaitAny(int *result);		// Wait for any of the current thread's
+					// requests; return its id, or -1 if
+					// there is nothing outstanding
+
+    void Complete(int id);		// Called by the worker thread
+    void ThreadExit(Thread *t);		// Forget requests owned by "t"
+    bool CloseFile(OpenFile *file);	// Close "file" when its requests
+					// are done; FALSE if none is in
+					// flight, and the caller should
+					// close it now
+
+  private:
+    void Retire(int id);		// Copy out read data, free the slot
+    bool InFlight(OpenFile *file);	// Any unfinished request on "file"?
+
+    AsyncRequest table[MaxAsyncRequests];
+    Lock *lock;				// protects the table
+    Condition *ioDone;			// signalled whenever a request finishes
+};
+
+#endif // ASYNCIO_H
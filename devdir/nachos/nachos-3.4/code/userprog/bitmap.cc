@@ -9,6 +9,24 @@
 #include "copyright.h"
 #include "bitmap.h"
 
+//----------------------------------------------------------------------
+// LowestBit
+// 	Return the number of the lowest bit set in "word", which isn't 0.
+//----------------------------------------------------------------------
+
+static int
+LowestBit(unsigned int word)
+{
+    int n = 0;
+
+    if ((word & 0xffff) == 0) { word >>= 16; n += 16; }
+    if ((word & 0xff) == 0) { word >>= 8; n += 8; }
+    if ((word & 0xf) == 0) { word >>= 4; n += 4; }
+    if ((word & 0x3) == 0) { word >>= 2; n += 2; }
+    if ((word & 0x1) == 0) n += 1;
+    return n;
+}
+
 //----------------------------------------------------------------------
 // BitMap::BitMap
 // 	Initialize a bitmap with "nitems" bits, so that every bit is clear.
@@ -22,8 +40,8 @@ BitMap::BitMap(int nitems)
     numBits = nitems;
     numWords = divRoundUp(numBits, BitsInWord);
     map = new unsigned int[numWords];
-    for (int i = 0; i < numBits; i++) 
-        Clear(i);
+    for (int i = 0; i < numWords; i++) 
+        map[i] = 0;
 }
 
 //----------------------------------------------------------------------
@@ -33,7 +51,7 @@ BitMap::BitMap(int nitems)
 
 BitMap::~BitMap()
 { 
-    delete map;
+    delete [] map;
 }
 
 //----------------------------------------------------------------------
@@ -94,27 +112,114 @@ BitMap::Test(int which)
 int 
 BitMap::Find() 
 {
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
-	}
-    return -1;
+    int i = NextClear(0);
+
+    if (i != -1)
+	Mark(i);
+    return i;
 }
 
-int BitMap::MyFind(int num){
-    for(int i=0; i<numBits; ++i){
-        int flag = 1;
-        for(int j=0; j<num; ++j)
-            if(Test(i+j))
-                flag = 0;
-        if(flag == 1){
-            for(int j=0; j<num; ++j)
-                Mark(i+j);
-            return i;
-        }
+//----------------------------------------------------------------------
+// BitMap::NextClear
+// 	Return the number of the first clear bit at or after "from", or
+//	-1 if there is none.  Words with every bit set are skipped whole.
+//----------------------------------------------------------------------
+
+int
+BitMap::NextClear(int from)
+{
+    int w, i;
+    unsigned int bits;
+
+    if (from >= numBits)
+	return -1;
+    w = from / BitsInWord;
+    bits = ~map[w] & (~0u << (from % BitsInWord));
+    while (bits == 0) {
+	if (++w == numWords)
+	    return -1;
+	bits = ~map[w];
     }
-    return -1;
+    i = w * BitsInWord + LowestBit(bits);
+    return (i < numBits) ? i : -1;	// the spare bits at the end
+}					// are always clear
+
+//----------------------------------------------------------------------
+// BitMap::NextSet
+// 	Return the number of the first set bit at or after "from", or
+//	"numBits" if there is none.  Words with no bit set are skipped
+//	whole.
+//----------------------------------------------------------------------
+
+int
+BitMap::NextSet(int from)
+{
+    int w;
+    unsigned int bits;
+
+    if (from >= numBits)
+	return numBits;
+    w = from / BitsInWord;
+    bits = map[w] & (~0u << (from % BitsInWord));
+    while (bits == 0) {
+	if (++w == numWords)
+	    return numBits;
+	bits = map[w];
+    }
+    return w * BitsInWord + LowestBit(bits);
+}
+
+//----------------------------------------------------------------------
+// BitMap::FindRun
+// 	Find and allocate a run of consecutive clear bits.  Of the runs at
+//	least "num" long, take the shortest (best fit), so that long runs
+//	are saved for the files that need them; among equally good runs,
+//	take the one starting nearest "hint".  If no run is long enough,
+//	take the longest there is, and let the caller ask again for the
+//	rest.
+//
+//	Return the number of the first bit allocated, and store how many
+//	were allocated in "*length".  If no bits are clear, return -1.
+//
+//	"num" -- the number of bits wanted
+//	"hint" -- where the caller would like them to be, or -1
+//----------------------------------------------------------------------
+
+int
+BitMap::FindRun(int num, int hint, int *length)
+{
+    int best = -1, bestLen = 0, bestDist = 0;
+
+    ASSERT(num > 0);
+    for (int i = NextClear(0); i != -1; i = NextClear(i)) {
+	int start = i;
+
+	i = NextSet(start);
+	int len = i - start;
+	int dist = (hint < 0) ? 0 : ((start > hint) ? start - hint : hint - start);
+	bool better;
+
+	if (best == -1)
+	    better = TRUE;
+	else if ((len >= num) != (bestLen >= num))
+	    better = (len >= num);		// a run that fits beats one
+	else if (len != bestLen)		// that doesn't
+	    better = (len >= num) ? (len < bestLen) : (len > bestLen);
+	else
+	    better = (dist < bestDist);
+	if (better) {
+	    best = start;
+	    bestLen = len;
+	    bestDist = dist;
+	}
+    }
+    if (best == -1)
+	return -1;
+
+    *length = min(num, bestLen);
+    for (int i = best; i < best + *length; i++)
+	Mark(i);
+    return best;
 }
 
 //----------------------------------------------------------------------
@@ -126,10 +231,11 @@ int BitMap::MyFind(int num){
 int 
 BitMap::NumClear() 
 {
-    int count = 0;
+    int count = numBits;
 
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) count++;
+    for (int w = 0; w < numWords; w++)
+	for (unsigned int bits = map[w]; bits != 0; bits &= bits - 1)
+	    count--;			// one for each bit set
     return count;
 }
 
@@ -3,7 +3,8 @@
 //	can be either on or off.
 //
 //	Represented as an array of unsigned integers, on which we do
-//	modulo arithmetic to find the bit we are interested in.
+//	modulo arithmetic to find the bit we are interested in.  Searches
+//	skip a whole word at a time when it is all set (or all clear).
 //
 //	The bitmap can be parameterized with with the number of bits being 
 //	managed.
@@ -35,17 +36,21 @@ class BitMap {
   public:
     BitMap(int nitems);		// Initialize a bitmap, with "nitems" bits
 				// initially, all bits are cleared.
-    ~BitMap();			// De-allocate bitmap
+    virtual ~BitMap();		// De-allocate bitmap
     
-    void Mark(int which);   	// Set the "nth" bit
-    void Clear(int which);  	// Clear the "nth" bit
+    virtual void Mark(int which);   	// Set the "nth" bit
+    virtual void Clear(int which);  	// Clear the "nth" bit
     bool Test(int which);   	// Is the "nth" bit set?
     int Find();            	// Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
-    int MyFind(int num);
+    int FindRun(int num, int hint, int *length);
+				// Allocate a run of up to "num" clear
+				// bits, best fit, nearest "hint";
+				// return its first bit, and its length
+				// in "*length".  -1 if none are clear.
     
-    int NumClear();		// Return the number of clear bits
+    virtual int NumClear();	// Return the number of clear bits
 
     void Print();		// Print contents of bitmap
     
@@ -54,7 +59,12 @@ class BitMap {
     void FetchFrom(OpenFile *file); 	// fetch contents from disk 
     void WriteBack(OpenFile *file); 	// write contents to disk
 
-  private:
+  protected:
+    virtual int NextClear(int from);	// First clear bit at or after
+					// "from", -1 if there is none
+    int NextSet(int from);		// First set bit at or after "from",
+					// "numBits" if there is none
+
     int numBits;			// number of bits in the bitmap
     int numWords;			// number of words of bitmap storage
 					// (rounded up if numBits is not a
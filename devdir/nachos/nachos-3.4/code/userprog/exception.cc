@@ -25,6 +25,7 @@
 #include "system.h"
 #include "syscall.h"
 #include "noff.h"
+#include "console.h"
 
 static void
 SwapHeader (NoffHeader *noffH)
@@ -64,6 +65,81 @@ SwapHeader (NoffHeader *noffH)
 //	are in machine.h.
 //----------------------------------------------------------------------
 
+//----------------------------------------------------------------------
+// ReadUserWord
+// WriteUserWord
+// ReadUserString
+// 	Fetch or store a word, or fetch a null-terminated string, in the
+//	current user program's memory.  If the page isn't resident (or,
+//	with a TLB, isn't in the TLB), the first ReadMem/WriteMem faults
+//	it in and fails, so try again.  The string is returned in a new
+//	buffer, which the caller must delete.
+//----------------------------------------------------------------------
+
+int
+ReadUserWord(int addr, int size)
+{
+    int value = 0;
+    if (!machine->ReadMem(addr, size, &value))
+        machine->ReadMem(addr, size, &value);
+    return value;
+}
+
+void
+WriteUserWord(int addr, int size, int value)
+{
+    if (!machine->WriteMem(addr, size, value))
+        machine->WriteMem(addr, size, value);
+}
+
+static char *
+ReadUserString(int addr)
+{
+    int len = 0;
+    while (ReadUserWord(addr + len, 1) != 0)
+        len++;
+    char *str = new char[len + 1];
+    for (int i = 0; i < len; i++)
+        str[i] = (char) ReadUserWord(addr + i, 1);
+    str[len] = '\0';
+    return str;
+}
+
+//----------------------------------------------------------------------
+// RememberId
+// ForgetId
+// 	Record, or stop recording, that the current program has "id"
+//	open, so that Exit can close it.  RememberId returns FALSE if the
+//	table is full; ForgetId returns FALSE if "id" wasn't open, and
+//	then it mustn't be closed.
+//----------------------------------------------------------------------
+
+static bool
+RememberId(int id)
+{
+    AddrSpace *space = currentThread->space;
+
+    for (int i = 0; i < MaxOpenIds; i++)
+        if (space->openIds[i] == -1) {
+            space->openIds[i] = id;
+            return TRUE;
+        }
+    return FALSE;
+}
+
+static bool
+ForgetId(int id)
+{
+    AddrSpace *space = currentThread->space;
+
+    for (int i = 0; i < MaxOpenIds; i++)
+        if (space->openIds[i] == id) {
+            space->openIds[i] = -1;
+            return TRUE;
+        }
+    return FALSE;
+}
+
 void CreateFunc(){
     printf("System Call Create..\n");
     //获取参数name字符串的地址
@@ -118,18 +194,97 @@ void OpenFunc(){
     printf("Open the file: %s\n", filename);
     //将OpenFile数据结构转化为整数
     OpenFile *tmpopenfile = fileSystem->Open(filename);
+    //打开的文件太多时失败，返回0
+    if (tmpopenfile != NULL && !RememberId(int(tmpopenfile))) {
+        delete tmpopenfile;
+        tmpopenfile = NULL;
+    }
     machine->WriteRegister(2, int(tmpopenfile));
     printf("The Openfile ID is %d\n", int(tmpopenfile));
     machine->AddvancePC();
 }
 
+//----------------------------------------------------------------------
+// ResolveId
+// 	Map ConsoleInput/ConsoleOutput to whatever the current thread's
+//	standard input/output refers to (the console, or a pipe end set up
+//	by Dup2 or inherited through Exec).  Other ids are returned as is.
+//----------------------------------------------------------------------
+
+static int
+ResolveId(int id)
+{
+    if (id == ConsoleInput)
+        return currentThread->stdIn;
+    if (id == ConsoleOutput)
+        return currentThread->stdOut;
+    return id;
+}
+
+//----------------------------------------------------------------------
+// UserConsole
+// 	Return the console used for ConsoleInput/ConsoleOutput, creating
+//	it the first time a user program touches it.
+//----------------------------------------------------------------------
+
+static SynchConsole *userConsole = NULL;
+
+static SynchConsole *
+UserConsole()
+{
+    if (userConsole == NULL)
+        userConsole = new SynchConsole(NULL, NULL);
+    return userConsole;
+}
+
+//----------------------------------------------------------------------
+// CloseId
+// 	Release the file or pipe end "id".  A pipe end only drops a
+//	reference; the pipe goes when both ends are closed.
+//----------------------------------------------------------------------
+
+static void
+CloseId(int id)
+{
+    if (pipeTable->IsPipe(id)) {
+        pipeTable->Close(id);
+    } else if (id != ConsoleInput && id != ConsoleOutput) {
+        OpenFile *openfile = (OpenFile *) id;
+        //仍有异步请求在用的文件，由最后一个请求完成时关闭
+        if (!asyncIO->CloseFile(openfile))
+            delete openfile;
+    }
+}
+
+//----------------------------------------------------------------------
+// CloseAllIds
+// 	Close everything the current program still has open, so that
+//	an exiting writer lets the pipe's readers see end of file.
+//----------------------------------------------------------------------
+
+static void
+CloseAllIds()
+{
+    AddrSpace *space = currentThread->space;
+
+    for (int i = 0; i < MaxOpenIds; i++)
+        if (space->openIds[i] != -1) {
+            CloseId(space->openIds[i]);
+            space->openIds[i] = -1;
+        }
+}
+
 void CloseFunc(){
     printf("System Call Close..\n");
     //获取OpenFileId
     int id = machine->ReadRegister(4);
     printf("Close Openfile %d\n", id);
-    OpenFile *openfile = (OpenFile *) id;
-    delete openfile;
+    //只关闭本程序打开着的文件或管道端，重复关闭或无效的id返回-1
+    if (ForgetId(id)) {
+        CloseId(id);
+        machine->WriteRegister(2, 0);
+    } else
+        machine->WriteRegister(2, -1);
     machine->AddvancePC();
 }
 
@@ -138,7 +293,7 @@ void WriteFunc(){
     //获取buffer的地址,size,id
     int bufferaddr = machine->ReadRegister(4);
     int size = machine->ReadRegister(5);
-    int id = machine->ReadRegister(6);
+    int id = ResolveId(machine->ReadRegister(6));
     //获取所有需要写的内容
     char *buffer = new char[size + 1];
     for (int i = 0; i < size; i++) {
@@ -146,8 +301,17 @@ void WriteFunc(){
         machine->ReadMem(bufferaddr + i, 1, &value);
         buffer[i] = (char) value;
     }
-    OpenFile *openfile = (OpenFile *) id;
-    openfile->Write(buffer, size);
+    if (id == ConsoleOutput) {
+        for (int i = 0; i < size; i++)
+            UserConsole()->PutChar(buffer[i]);
+    } else if (pipeTable->IsPipe(id)) {
+        //管道满时在这里阻塞，直到读者取走数据
+        pipeTable->Write(id, buffer, size);
+    } else {
+        OpenFile *openfile = (OpenFile *) id;
+        openfile->Write(buffer, size);
+    }
+    delete [] buffer;
     machine->AddvancePC();
 }
 
@@ -156,20 +320,182 @@ void ReadFunc(){
     //获取buffer的地址,size,id
     int bufferaddr = machine->ReadRegister(4);
     int size = machine->ReadRegister(5);
-    int id = machine->ReadRegister(6);
+    int id = ResolveId(machine->ReadRegister(6));
     //从bufferaddr开始写size个字符
-    OpenFile *op = (OpenFile *) id;
     char *buffer = new char[size + 1];
-    int res = op->Read(buffer, size);
+    int res;
+    if (id == ConsoleInput) {
+        //控制台至少等到一个字符
+        res = 0;
+        if (size > 0)
+            buffer[res++] = UserConsole()->GetChar();
+    } else if (pipeTable->IsPipe(id)) {
+        //管道为空时阻塞，写端全部关闭后返回0
+        res = pipeTable->Read(id, buffer, size);
+    } else {
+        OpenFile *op = (OpenFile *) id;
+        res = op->Read(buffer, size);
+    }
     for (int i = 0; i < res; i++) {
         machine->WriteMem(bufferaddr + i, 1, int(buffer[i]));
     }
-    buffer[size] = '\0';
+    buffer[(res > 0) ? res : 0] = '\0';
     printf("Read from Openfile %d: %s\n", id, buffer);
+    delete [] buffer;
     machine->WriteRegister(2, res);
     machine->AddvancePC();
 }
 
+void PipeFunc(){
+    printf("System Call Pipe..\n");
+    //获取存放两个OpenFileId的数组地址
+    int fdsaddr = machine->ReadRegister(4);
+    int readId, writeId;
+    if (!pipeTable->Create(&readId, &writeId)) {
+        machine->WriteRegister(2, -1);
+        machine->AddvancePC();
+        return;
+    }
+    printf("Pipe created, read end %d, write end %d\n", readId, writeId);
+    if (!RememberId(readId) || !RememberId(writeId)) {
+        ForgetId(readId);
+        pipeTable->Close(readId);
+        pipeTable->Close(writeId);
+        machine->WriteRegister(2, -1);
+        machine->AddvancePC();
+        return;
+    }
+    WriteUserWord(fdsaddr, 4, readId);
+    WriteUserWord(fdsaddr + 4, 4, writeId);
+    machine->WriteRegister(2, 0);
+    machine->AddvancePC();
+}
+
+void Dup2Func(){
+    printf("System Call Dup2..\n");
+    int id = machine->ReadRegister(4);
+    int std = machine->ReadRegister(5);
+    //只能把标准输入输出重定向到管道；id等于std时恢复为控制台
+    int *slot = NULL;
+    if (std == ConsoleInput)
+        slot = &currentThread->stdIn;
+    else if (std == ConsoleOutput)
+        slot = &currentThread->stdOut;
+    if (slot == NULL || (id != std && !pipeTable->IsPipe(id))) {
+        machine->WriteRegister(2, -1);
+        machine->AddvancePC();
+        return;
+    }
+    if (pipeTable->IsPipe(id))
+        pipeTable->Open(id);
+    if (pipeTable->IsPipe(*slot))
+        pipeTable->Close(*slot);
+    *slot = id;
+    machine->WriteRegister(2, 0);
+    machine->AddvancePC();
+}
+
+void AsyncReadFunc(){
+    printf("System Call AsyncRead..\n");
+    //获取buffer的地址,size,id
+    int bufferaddr = machine->ReadRegister(4);
+    int size = machine->ReadRegister(5);
+    int id = machine->ReadRegister(6);
+    //登记请求后立即返回请求号，数据由内核线程在磁盘中断后读入
+    int req = -1;
+    if (id >= PipeIdBase + 2 * MaxPipes)  //只支持普通文件
+        req = asyncIO->Submit((OpenFile *) id, bufferaddr, size, FALSE);
+    if (req != -1)
+        asyncIO->Start(req);
+    machine->WriteRegister(2, req);
+    machine->AddvancePC();
+}
+
+void AsyncWriteFunc(){
+    printf("System Call AsyncWrite..\n");
+    //获取buffer的地址,size,id
+    int bufferaddr = machine->ReadRegister(4);
+    int size = machine->ReadRegister(5);
+    int id = machine->ReadRegister(6);
+    int req = -1;
+    if (id >= PipeIdBase + 2 * MaxPipes)  //只支持普通文件
+        req = asyncIO->Submit((OpenFile *) id, bufferaddr, size, TRUE);
+    if (req != -1) {
+        //先把要写的内容复制到内核缓冲区，用户程序随后可以继续运行
+        char *buffer = asyncIO->Buffer(req);
+        for (int i = 0; i < size; i++) {
+            buffer[i] = (char) ReadUserWord(bufferaddr + i, 1);
+        }
+        asyncIO->Start(req);
+    }
+    machine->WriteRegister(2, req);
+    machine->AddvancePC();
+}
+
+void PollFunc(){
+    int req = machine->ReadRegister(4);
+    //请求未完成返回-1，请求号无效返回-2，完成则返回传输的字节数
+    machine->WriteRegister(2, asyncIO->Poll(req));
+    machine->AddvancePC();
+}
+
+void WaitAnyFunc(){
+    printf("System Call WaitAny..\n");
+    int resultaddr = machine->ReadRegister(4);
+    int result = 0;
+    //等待当前线程任意一个请求完成
+    int req = asyncIO->WaitAny(&result);
+    if (req != -1 && resultaddr != 0)
+        WriteUserWord(resultaddr, 4, result);
+    machine->WriteRegister(2, req);
+    machine->AddvancePC();
+}
+
+void ShmCreateFunc(){
+    printf("System Call ShmCreate..\n");
+    int key = machine->ReadRegister(4);
+    int size = machine->ReadRegister(5);
+    machine->WriteRegister(2, shmTable->Create(currentThread->space, key, size));
+    machine->AddvancePC();
+}
+
+void ShmAttachFunc(){
+    printf("System Call ShmAttach..\n");
+    int id = machine->ReadRegister(4);
+    //把共享段的物理页追加到当前地址空间的页表末尾
+    int addr = shmTable->Attach(currentThread->space, id);
+    printf("Shared segment %d attached at %d\n", id, addr);
+    machine->WriteRegister(2, addr);
+    machine->AddvancePC();
+}
+
+void ShmDetachFunc(){
+    printf("System Call ShmDetach..\n");
+    int addr = machine->ReadRegister(4);
+    machine->WriteRegister(2, shmTable->Detach(currentThread->space, addr));
+    machine->AddvancePC();
+}
+
+void SemCreateFunc(){
+    printf("System Call SemCreate..\n");
+    int value = machine->ReadRegister(4);
+    machine->WriteRegister(2, semTable->Create(value));
+    machine->AddvancePC();
+}
+
+void SemWaitFunc(){
+    int id = machine->ReadRegister(4);
+    //信号量为0时在内核中阻塞
+    machine->WriteRegister(2, semTable->Wait(id) ? 0 : -1);
+    machine->AddvancePC();
+}
+
+void SemSignalFunc(){
+    int id = machine->ReadRegister(4);
+    machine->WriteRegister(2, semTable->Signal(id) ? 0 : -1);
+    machine->AddvancePC();
+}
+
 void execfunc(int arg) {
     //根据传进的参数获取可执行文件名
     char *filename = (char *) arg;
@@ -189,6 +515,176 @@ void execfunc(int arg) {
     machine->Run();
 }
 
+void spawnfunc(int arg) {
+    //父线程已经建好地址空间、参数和寄存器，这里只需装入后运行
+    currentThread->RestoreUserState();
+    currentThread->space->RestoreState();
+    machine->Run();
+}
+
+void SpawnFunc(){
+    printf("System Call Spawn..\n");
+    //获取可执行文件名和以0结尾的argv数组
+    char *filename = ReadUserString(machine->ReadRegister(4));
+    int argvaddr = machine->ReadRegister(5);
+    char *argv[MaxSpawnArgs];
+    int argc = 0;
+    if (argvaddr != 0) {
+        for (; argc < MaxSpawnArgs; argc++) {
+            int p = ReadUserWord(argvaddr + 4 * argc, 4);
+            if (p == 0)
+                break;
+            argv[argc] = ReadUserString(p);
+        }
+    }
+    OpenFile *executable = fileSystem->Open(filename);
+    if (executable == NULL) {
+        printf("Unable to open file %s\n", filename);
+        for (int i = 0; i < argc; i++)
+            delete [] argv[i];
+        delete [] filename;
+        machine->WriteRegister(2, -1);
+        machine->AddvancePC();
+        return;
+    }
+    //在当前线程中直接建立地址空间，并尽量把页面预先装入空闲的物理页
+    Thread *newthread = new Thread("Thread");
+    int tid = newthread->getTID();
+    AddrSpace *space = new AddrSpace(executable);
+    space->filename = filename;
+    space->Preload(executable);
+    delete executable;
+    newthread->space = space;
+    newthread->setName(filename);
+    
+    //把参数字符串和argv指针数组放在新栈的顶部
+    int ptrs[MaxSpawnArgs + 1];
+    int addr = space->numPages * PageSize - 16;
+    for (int i = argc - 1; i >= 0; i--) {
+        int len = strlen(argv[i]) + 1;
+        addr -= len;
+        space->WriteUser(addr, argv[i], len);
+        ptrs[i] = addr;
+        delete [] argv[i];
+    }
+    ptrs[argc] = 0;
+    addr = (addr & ~3) - (argc + 1) * 4;
+    for (int i = 0; i <= argc; i++) {
+        int word = WordToMachine((unsigned int) ptrs[i]);
+        space->WriteUser(addr + 4 * i, (char *) &word, 4);
+    }
+    //设置新进程的寄存器，main(argc, argv)从r4,r5取参数
+    for (int i = 0; i < NumTotalRegs; i++)
+        newthread->SetUserRegister(i, 0);
+    newthread->SetUserRegister(PCReg, 0);
+    newthread->SetUserRegister(NextPCReg, 4);
+    newthread->SetUserRegister(StackReg, addr - 16);
+    newthread->SetUserRegister(4, argc);
+    newthread->SetUserRegister(5, addr);
+    
+    //子进程继承标准输入输出（可能是管道）
+    newthread->stdIn = currentThread->stdIn;
+    newthread->stdOut = currentThread->stdOut;
+    if (pipeTable->IsPipe(newthread->stdIn))
+        pipeTable->Open(newthread->stdIn);
+    if (pipeTable->IsPipe(newthread->stdOut))
+        pipeTable->Open(newthread->stdOut);
+    
+    printf("Spawned %s as thread %d with %d arguments\n", filename, tid, argc);
+    machine->WriteRegister(2, tid);
+    machine->AddvancePC();
+    newthread->Fork(spawnfunc, 0);
+}
+
+void ThreadCreateFunc(){
+    printf("System Call ThreadCreate..\n");
+    //获取函数地址、参数、栈地址，以及函数返回后要跳转的ExitThread桩
+    int func = machine->ReadRegister(4);
+    int arg = machine->ReadRegister(5);
+    int stack = machine->ReadRegister(6);
+    int exitpc = machine->ReadRegister(7);
+    AddrSpace *space = currentThread->space;
+    Thread *newthread = new Thread("user thread");
+    int tid = newthread->getTID();
+    //没有给出栈时，在地址空间中为新线程分配一段独立的栈
+    if (stack == 0)
+        stack = space->AllocThreadStack(tid);
+    if (stack == -1) {
+        printf("Too many threads in %s\n", currentThread->getName());
+        threadTable->Remove(tid);	//线程从未运行，Finish不会释放它的槽
+        delete newthread;
+        machine->WriteRegister(2, -1);
+        machine->AddvancePC();
+        return;
+    }
+    newthread->space = space;
+    for (int i = 0; i < NumTotalRegs; i++)
+        newthread->SetUserRegister(i, 0);
+    newthread->SetUserRegister(PCReg, func);
+    newthread->SetUserRegister(NextPCReg, func + 4);
+    newthread->SetUserRegister(StackReg, stack);
+    newthread->SetUserRegister(RetAddrReg, exitpc);
+    newthread->SetUserRegister(4, arg);
+    newthread->stdIn = currentThread->stdIn;
+    newthread->stdOut = currentThread->stdOut;
+    if (pipeTable->IsPipe(newthread->stdIn))
+        pipeTable->Open(newthread->stdIn);
+    if (pipeTable->IsPipe(newthread->stdOut))
+        pipeTable->Open(newthread->stdOut);
+    printf("Thread %d created user thread %d, stack at %d\n",
+           currentThread->getTID(), tid, stack);
+    machine->WriteRegister(2, tid);
+    machine->AddvancePC();
+    newthread->Fork(spawnfunc, 0);
+}
+
+void ExitThreadFunc(){
+    printf("System Call ExitThread..\n");
+    //只结束当前线程，地址空间仍由其他线程使用
+    threadTable->SetExitStatus(currentThread->getTID(), machine->ReadRegister(4));
+    currentThread->space->FreeThreadStack(currentThread->getTID());
+    asyncIO->ThreadExit(currentThread);
+    if (pipeTable->IsPipe(currentThread->stdIn))
+        pipeTable->Close(currentThread->stdIn);
+    if (pipeTable->IsPipe(currentThread->stdOut))
+        pipeTable->Close(currentThread->stdOut);
+    //关中断直到Finish把线程移出线程表，等待者醒来时就看不到它了
+    (void) interrupt->SetLevel(IntOff);
+    currentThread->space->ThreadExiting();
+    currentThread->Finish();
+}
+
+void ThreadJoinFunc(){
+    printf("System Call ThreadJoin..\n");
+    int tid = machine->ReadRegister(4);
+    Thread *thread = threadTable->Find(tid);
+    if (thread != NULL && thread->space != currentThread->space) {
+        machine->WriteRegister(2, -1);
+        machine->AddvancePC();
+        return;
+    }
+    //在地址空间的信号量上睡眠，直到相应的线程结束
+    machine->WriteRegister(2, currentThread->space->JoinThread(tid));
+    machine->AddvancePC();
+}
+
+void FutexWaitFunc(){
+    int addr = machine->ReadRegister(4);
+    int val = machine->ReadRegister(5);
+    //先访问一次，保证该页在内存中，再在关中断下比较并睡眠
+    ReadUserWord(addr, 4);
+    bool slept = futexTable->Wait(currentThread->space, addr, val);
+    machine->WriteRegister(2, slept ? 0 : -1);
+    machine->AddvancePC();
+}
+
+void FutexWakeFunc(){
+    int addr = machine->ReadRegister(4);
+    int count = machine->ReadRegister(5);
+    machine->WriteRegister(2, futexTable->Wake(currentThread->space, addr, count));
+    machine->AddvancePC();
+}
+
 void ExecFunc(){
     printf("System Call Exec..\n");
     //获取参数name字符串的地址
@@ -217,6 +713,13 @@ void ExecFunc(){
     //        printf(".......%d %d \n", TIDstate[newthread->getTID()][0], TIDstate[newthread->getTID()][1]);
     printf("CurrentThread is %d,\n", currentThread->getTID());
     printf("the Thread to execute the executable is thread %d\n", newthread->getTID());
+    //子进程继承标准输入输出（可能是管道）
+    newthread->stdIn = currentThread->stdIn;
+    newthread->stdOut = currentThread->stdOut;
+    if (pipeTable->IsPipe(newthread->stdIn))
+        pipeTable->Open(newthread->stdIn);
+    if (pipeTable->IsPipe(newthread->stdOut))
+        pipeTable->Open(newthread->stdOut);
     machine->WriteRegister(2, newthread->getTID());
     newthread->Fork(execfunc, (int) filename);
     machine->AddvancePC();
@@ -263,12 +766,14 @@ void JoinFunc(){
     int spaceid = machine->ReadRegister(4);
     //spaceid表示要Join的线程的ID
     printf("Thread %d Waiting for Thread %d to Finish..\n", currentThread->getTID(), spaceid);
-    while (myThreads[spaceid] != NULL) { //等待相应的线程结束
+    //按句柄查找，线程号被重用后旧的spaceid不会误指新线程
+    while (threadTable->Find(spaceid) != NULL) { //等待相应的线程结束
         currentThread->Yield();
     }
-    printf("Thread %d exit with code %d\n", spaceid, ThreadExit[spaceid]);
+    int status = threadTable->GetExitStatus(spaceid);
+    printf("Thread %d exit with code %d\n", spaceid, status);
     //写返回值
-    machine->WriteRegister(2, ThreadExit[spaceid]);
+    machine->WriteRegister(2, status);
     /*printf("current PC is %d, next pc is %d, status is %d\n", machine->ReadRegister(PCReg),
            machine->ReadRegister(NextPCReg), currentThread->getstatus());
     printf("return address is %d\n", machine->ReadRegister(RetAddrReg));*/
@@ -288,6 +793,12 @@ ExceptionHandler(ExceptionType which)
     }
     
     else if(which == PageFaultException){
+        //页表之外或已卸下的共享页不能从可执行文件调入，是地址错误
+        if(!currentThread->space->IsMapped(machine->ReadRegister(BadVAddrReg))){
+            printf("Address error: %d is not mapped\n",
+                   machine->ReadRegister(BadVAddrReg));
+            ASSERT(FALSE);
+        }
         if(machine->TLBPageFaultHandler() == 0)
             return;
         
@@ -301,16 +812,28 @@ ExceptionHandler(ExceptionType which)
         machine->printTLB();
         printf("\n");*/
         
+        shmTable->DetachAll(currentThread->space);
         currentThread->space->clearMap();
         //machine->printPageBelong();
         printf("%s:A user porgram exit with code %d..\n", currentThread->getName(), machine->ReadRegister(4));
         //int NextPC = machine->ReadRegister(NextPCReg);
         //machine->WriteRegister(PCReg, NextPC);
         //printf("%s finished, tid is %d\n", currentThread->getName(), currentThread->getTID());
-        ThreadExit[currentThread->getTID()] = machine->ReadRegister(4);
+        threadTable->SetExitStatus(currentThread->getTID(), machine->ReadRegister(4));
+        asyncIO->ThreadExit(currentThread);
+        //关闭进程打开的文件和管道端，以及继承或重定向的管道端，
+        //最后一个写者退出时读者看到EOF
+        CloseAllIds();
+        if (pipeTable->IsPipe(currentThread->stdIn))
+            pipeTable->Close(currentThread->stdIn);
+        if (pipeTable->IsPipe(currentThread->stdOut))
+            pipeTable->Close(currentThread->stdOut);
         
         machine->AddvancePC();
         
+        //同一地址空间里ThreadJoin等待本线程的线程
+        (void) interrupt->SetLevel(IntOff);
+        currentThread->space->ThreadExiting();
         currentThread->Finish();
     }
     
@@ -338,6 +861,30 @@ ExceptionHandler(ExceptionType which)
         ExecFunc();
     }
     
+    else if(which == SyscallException && type == SC_Spawn){
+        SpawnFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_ThreadCreate){
+        ThreadCreateFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_ExitThread){
+        ExitThreadFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_ThreadJoin){
+        ThreadJoinFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_FutexWait){
+        FutexWaitFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_FutexWake){
+        FutexWakeFunc();
+    }
+    
     else if(which == SyscallException && type == SC_Fork){
         ForkFunc();
     }
@@ -349,6 +896,54 @@ ExceptionHandler(ExceptionType which)
     else if(which == SyscallException && type == SC_Join){
         JoinFunc();
     }
+    
+    else if(which == SyscallException && type == SC_AsyncRead){
+        AsyncReadFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_AsyncWrite){
+        AsyncWriteFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_Poll){
+        PollFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_WaitAny){
+        WaitAnyFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_Pipe){
+        PipeFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_Dup2){
+        Dup2Func();
+    }
+    
+    else if(which == SyscallException && type == SC_ShmCreate){
+        ShmCreateFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_ShmAttach){
+        ShmAttachFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_ShmDetach){
+        ShmDetachFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_SemCreate){
+        SemCreateFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_SemWait){
+        SemWaitFunc();
+    }
+    
+    else if(which == SyscallException && type == SC_SemSignal){
+        SemSignalFunc();
+    }
         
     else {
         printf("Unexpected user mode exception %d %d\n", which, type);
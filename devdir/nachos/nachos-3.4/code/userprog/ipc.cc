@@ -0,0 +1,309 @@
+// ipc.cc
+//	Routines to manage shared memory segments and user semaphores.
+//
+//	Segment frames are taken straight from machine->memoryMap when the
+//	segment is created, and are marked as referenced in
+//	machine->frameRef for as long as the segment exists, so the page
+//	replacement code never picks them.  The creator's reference and
+//	each attachment are counted the same way in both seg->refCount
+//	and frameRef, so the two reach zero together.
+
+#include "copyright.h"
+#include "system.h"
+#include "ipc.h"
+
+//----------------------------------------------------------------------
+// ShmTable::ShmTable
+// 	Initialize the table of shared memory segments to empty.
+//----------------------------------------------------------------------
+
+ShmTable::ShmTable()
+{
+    for (int i = 0; i < MaxShmSegments; i++)
+	segments[i].inUse = FALSE;
+}
+
+//----------------------------------------------------------------------
+// ShmTable::Create
+// 	Return the id of the segment named "key", creating it with "size"
+//	bytes of zeroed memory if it doesn't exist yet.  Return -1 if the
+//	segment is too big, or there aren't enough free frames or slots.
+//
+//	A new segment is held by "space", its creator, until that exits,
+//	so that it survives while nobody has it attached.
+//----------------------------------------------------------------------
+
+int
+ShmTable::Create(AddrSpace *space, int key, int size)
+{
+    int id = -1;
+    int numPages = divRoundUp(size, PageSize);
+
+    for (int i = 0; i < MaxShmSegments; i++)
+	if (segments[i].inUse && segments[i].key == key)
+	    return i;
+    if (numPages <= 0 || numPages > MaxShmPages)
+	return -1;
+    for (int i = 0; i < MaxShmSegments; i++)
+	if (!segments[i].inUse) {
+	    id = i;
+	    break;
+	}
+    if (id == -1 || machine->memoryMap->NumClear() < numPages)
+	return -1;
+
+    ShmSegment *seg = &segments[id];
+    seg->inUse = TRUE;
+    seg->key = key;
+    seg->numPages = numPages;
+    seg->refCount = 1;				// the creator's
+    seg->creator = space;
+    for (int i = 0; i < numPages; i++) {
+	int frame = machine->memoryMap->Find();
+
+	seg->frames[i] = frame;
+	machine->frameRef[frame] = 1;		// and pinned by it
+	machine->pageBelong[frame] = NULL;
+	machine->pageLRUtime[frame] = 0;
+	bzero(&machine->mainMemory[frame * PageSize], PageSize);
+    }
+    DEBUG('a', "Created shared segment %d, key %d, %d pages\n",
+	  id, key, numPages);
+    return id;
+}
+
+//----------------------------------------------------------------------
+// ShmTable::Attach
+// 	Map segment "id" into "space", and return the virtual address it
+//	was mapped at (-1 on error).
+//----------------------------------------------------------------------
+
+int
+ShmTable::Attach(AddrSpace *space, int id)
+{
+    int slot = -1;
+
+    if (id < 0 || id >= MaxShmSegments || !segments[id].inUse)
+	return -1;
+    for (int i = 0; i < MaxShmAttach; i++)
+	if (space->shmIds[i] == -1) {
+	    slot = i;
+	    break;
+	}
+    if (slot == -1)
+	return -1;
+
+    ShmSegment *seg = &segments[id];
+    int addr = space->MapShared(seg->frames, seg->numPages);
+    for (int i = 0; i < seg->numPages; i++)
+	machine->frameRef[seg->frames[i]]++;
+    seg->refCount++;
+    space->shmIds[slot] = id;
+    space->shmAddrs[slot] = addr;
+    return addr;
+}
+
+//----------------------------------------------------------------------
+// ShmTable::Detach
+// 	Unmap the segment that "space" has attached at "addr".
+//----------------------------------------------------------------------
+
+int
+ShmTable::Detach(AddrSpace *space, int addr)
+{
+    for (int i = 0; i < MaxShmAttach; i++)
+	if (space->shmIds[i] != -1 && space->shmAddrs[i] == addr) {
+	    int id = space->shmIds[i];
+
+	    space->UnmapShared(addr, segments[id].numPages);
+	    for (int j = 0; j < segments[id].numPages; j++)
+		machine->frameRef[segments[id].frames[j]]--;
+	    space->shmIds[i] = -1;
+	    Release(id);
+	    return 0;
+	}
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// ShmTable::DetachAll
+// 	Detach every segment still attached to "space", and drop the
+//	hold it has on the segments it created.
+//----------------------------------------------------------------------
+
+void
+ShmTable::DetachAll(AddrSpace *space)
+{
+    for (int i = 0; i < MaxShmAttach; i++)
+	if (space->shmIds[i] != -1)
+	    Detach(space, space->shmAddrs[i]);
+    for (int id = 0; id < MaxShmSegments; id++)
+	if (segments[id].inUse && segments[id].creator == space) {
+	    segments[id].creator = NULL;
+	    for (int j = 0; j < segments[id].numPages; j++)
+		machine->frameRef[segments[id].frames[j]]--;
+	    Release(id);
+	}
+}
+
+//----------------------------------------------------------------------
+// ShmTable::Release
+// 	Drop a reference to segment "id" (the caller has already dropped
+//	it from frameRef); when the last one goes, give its frames back
+//	to the machine.
+//----------------------------------------------------------------------
+
+void
+ShmTable::Release(int id)
+{
+    ShmSegment *seg = &segments[id];
+
+    ASSERT(seg->refCount > 0);
+    if (--seg->refCount > 0)
+	return;
+    for (int i = 0; i < seg->numPages; i++) {
+	ASSERT(machine->frameRef[seg->frames[i]] == 0);
+	machine->memoryMap->Clear(seg->frames[i]);
+    }
+    seg->inUse = FALSE;
+    DEBUG('a', "Freed shared segment %d\n", id);
+}
+
+//----------------------------------------------------------------------
+// SemTable::SemTable
+// 	Initialize the table of user semaphores to empty.
+//----------------------------------------------------------------------
+
+SemTable::SemTable()
+{
+    for (int i = 0; i < MaxUserSems; i++)
+	sems[i] = NULL;
+}
+
+SemTable::~SemTable()
+{
+    for (int i = 0; i < MaxUserSems; i++)
+	if (sems[i] != NULL)
+	    delete sems[i];
+}
+
+//----------------------------------------------------------------------
+// SemTable::Create
+// 	Make a semaphore with initial value "value", and return its id.
+//----------------------------------------------------------------------
+
+int
+SemTable::Create(int value)
+{
+    if (value < 0)
+	return -1;
+    for (int i = 0; i < MaxUserSems; i++)
+	if (sems[i] == NULL) {
+	    sems[i] = new Semaphore("user semaphore", value);
+	    return i;
+	}
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// SemTable::Wait
+// SemTable::Signal
+// 	P() or V() the semaphore "id".  Return FALSE if there is no
+//	such semaphore.
+//----------------------------------------------------------------------
+
+bool
+SemTable::Wait(int id)
+{
+    if (id < 0 || id >= MaxUserSems || sems[id] == NULL)
+	return FALSE;
+    sems[id]->P();
+    return TRUE;
+}
+
+bool
+SemTable::Signal(int id)
+{
+    if (id < 0 || id >= MaxUserSems || sems[id] == NULL)
+	return FALSE;
+    sems[id]->V();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::FutexTable
+// 	Initialize the list of futex waiters to empty.
+//----------------------------------------------------------------------
+
+FutexTable::FutexTable()
+{
+    waiters = new List;
+}
+
+FutexTable::~FutexTable()
+{
+    delete waiters;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::Wait
+// 	If the word at "addr" in the current address space still holds
+//	"val", go to sleep until a FutexWake on the same word.  The check
+//	and the sleep are done with interrupts off, so a wakeup can't be
+//	lost in between.
+//
+//	The caller should have touched the word already; if it isn't
+//	resident we don't wait for the page fault, and just return FALSE,
+//	which the user program treats like a changed value (try again).
+//----------------------------------------------------------------------
+
+bool
+FutexTable::Wait(AddrSpace *space, int addr, int val)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int value;
+
+    if (!machine->ReadMem(addr, 4, &value) || value != val) {
+	(void) interrupt->SetLevel(oldLevel);
+	return FALSE;
+    }
+
+    FutexWaiter *waiter = new FutexWaiter;
+    waiter->space = space;
+    waiter->addr = addr;
+    waiter->thread = currentThread;
+    waiters->Append((void *)waiter);
+    currentThread->Sleep();
+
+    (void) interrupt->SetLevel(oldLevel);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::Wake
+// 	Put back on the ready list up to "count" of the threads waiting
+//	on the word at "addr" in "space", oldest first.
+//----------------------------------------------------------------------
+
+int
+FutexTable::Wake(AddrSpace *space, int addr, int count)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    List *others = new List;
+    FutexWaiter *waiter;
+    int woken = 0;
+
+    while ((waiter = (FutexWaiter *)waiters->Remove()) != NULL) {
+	if (woken < count && waiter->space == space && waiter->addr == addr) {
+	    scheduler->ReadyToRun(waiter->thread);
+	    delete waiter;
+	    woken++;
+	} else
+	    others->Append((void *)waiter);
+    }
+    delete waiters;
+    waiters = others;
+
+    (void) interrupt->SetLevel(oldLevel);
+    return woken;
+}
@@ -0,0 +1,116 @@
+// ipc.h
+//	Data structures for sharing memory and semaphores between user
+//	programs.
+//
+//	A shared memory segment is a set of physical frames that is mapped
+//	into the page table of every address space that attaches it, so
+//	programs exchange data without copying it through the kernel.
+//	The frames are allocated when the segment is created, and stay
+//	pinned (Machine::frameRef > 0) so that pageLRUReplace never evicts
+//	them.  The address space that created the segment holds one
+//	reference until it exits, and each attachment holds another; the
+//	segment is freed when the last reference goes.
+//
+//	User semaphores are kernel Semaphores named by a small integer,
+//	for synchronizing access to shared segments.
+//
+//	Futexes let threads of one user program sleep on a word of their
+//	own memory: FutexWait only blocks if the word still holds the value
+//	the caller saw, so a user-level lock need only trap into the kernel
+//	when it is contended.
+
+#ifndef IPC_H
+#define IPC_H
+
+#include "copyright.h"
+
+#define MaxShmSegments	8		// segments in the system at once
+#define MaxShmPages	8		// largest segment, in pages
+#define MaxShmAttach	4		// segments attached to one address space
+#define MaxUserSems	32		// user semaphores in the system at once
+
+class AddrSpace;
+class Semaphore;
+class Thread;
+class List;
+
+// One shared memory segment.
+
+class ShmSegment {
+  public:
+    bool inUse;				// is this slot allocated?
+    int key;				// name chosen by the user programs
+    int numPages;			// size of the segment
+    int frames[MaxShmPages];		// physical page of each virtual page
+    int refCount;			// attachments, plus one for the
+					// creator until it exits
+    AddrSpace *creator;			// NULL once it has let go
+};
+
+// The table of shared memory segments.
+
+class ShmTable {
+  public:
+    ShmTable();
+
+    int Create(AddrSpace *space, int key, int size);
+					// Find or make the segment "key";
+					// return its id, or -1
+    int Attach(AddrSpace *space, int id);
+					// Map segment "id" into "space";
+					// return its virtual address, or -1
+    int Detach(AddrSpace *space, int addr);
+					// Unmap the segment at "addr"; 0 or -1
+    void DetachAll(AddrSpace *space);	// Called when a program exits;
+					// also drops the creator's hold
+
+  private:
+    void Release(int id);		// Drop a reference to segment "id"
+
+    ShmSegment segments[MaxShmSegments];
+};
+
+// The table of user semaphores.
+
+class SemTable {
+  public:
+    SemTable();
+    ~SemTable();
+
+    int Create(int value);		// Return the id of a new semaphore,
+					// or -1 if the table is full
+    bool Wait(int id);			// P() on semaphore "id"
+    bool Signal(int id);		// V() on semaphore "id"
+
+  private:
+    Semaphore *sems[MaxUserSems];
+};
+
+// A thread sleeping in FutexWait.
+
+class FutexWaiter {
+  public:
+    AddrSpace *space;			// address space of the futex word
+    int addr;				// and its virtual address
+    Thread *thread;			// who is waiting
+};
+
+// The threads waiting on futexes, in the order they went to sleep.
+
+class FutexTable {
+  public:
+    FutexTable();
+    ~FutexTable();
+
+    bool Wait(AddrSpace *space, int addr, int val);
+					// Sleep if the word at "addr" is
+					// still "val"; FALSE if it isn't
+    int Wake(AddrSpace *space, int addr, int count);
+					// Wake up to "count" waiters on
+					// "addr"; return how many woke
+
+  private:
+    List *waiters;			// FutexWaiter's
+};
+
+#endif // IPC_H
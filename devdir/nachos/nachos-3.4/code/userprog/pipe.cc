@@ -0,0 +1,236 @@
+// pipe.cc
+//	Routines to pass data between user programs through a bounded
+//	buffer in kernel memory.
+//
+//	This is the classic producer/consumer problem, solved with a lock
+//	and two condition variables.  A pipe goes away when the last
+//	reference to either end is released; ends are referenced by the
+//	Pipe call itself, by Dup2 and by a child inheriting its parent's
+//	standard input/output in Exec.
+
+#include "copyright.h"
+#include "system.h"
+#include "pipe.h"
+
+//----------------------------------------------------------------------
+// KernelPipe::KernelPipe
+// 	Initialize an empty pipe with one read end and one write end.
+//----------------------------------------------------------------------
+
+KernelPipe::KernelPipe()
+{
+    head = count = 0;
+    readers = writers = 1;
+    lock = new Lock("pipe lock");
+    notEmpty = new Condition("pipe not empty");
+    notFull = new Condition("pipe not full");
+}
+
+KernelPipe::~KernelPipe()
+{
+    delete lock;
+    delete notEmpty;
+    delete notFull;
+}
+
+//----------------------------------------------------------------------
+// KernelPipe::Read
+// 	Wait until there is something in the pipe, then take up to
+//	"numBytes" bytes.  Return 0 (end of file) if the pipe is empty
+//	and no write end is left open.
+//----------------------------------------------------------------------
+
+int
+KernelPipe::Read(char *into, int numBytes)
+{
+    int n = 0;
+
+    lock->Acquire();
+    while (count == 0 && writers > 0)
+	notEmpty->Wait(lock);
+    while (n < numBytes && count > 0) {
+	into[n++] = buffer[head];
+	head = (head + 1) % PipeSize;
+	count--;
+    }
+    if (n > 0)
+	notFull->Broadcast(lock);
+    lock->Release();
+    return n;
+}
+
+//----------------------------------------------------------------------
+// KernelPipe::Write
+// 	Copy "numBytes" bytes into the pipe, waiting for readers to make
+//	room whenever it fills up.  Return -1 if there is no read end left.
+//----------------------------------------------------------------------
+
+int
+KernelPipe::Write(char *from, int numBytes)
+{
+    int n = 0;
+
+    lock->Acquire();
+    while (n < numBytes) {
+	while (count == PipeSize && readers > 0)
+	    notFull->Wait(lock);
+	if (readers == 0)
+	    break;
+	while (n < numBytes && count < PipeSize) {
+	    buffer[(head + count) % PipeSize] = from[n++];
+	    count++;
+	}
+	notEmpty->Broadcast(lock);
+    }
+    lock->Release();
+    return (readers == 0) ? -1 : n;
+}
+
+//----------------------------------------------------------------------
+// KernelPipe::Open
+// 	Add a reference to the read end, or to the write end if "writing".
+//----------------------------------------------------------------------
+
+void
+KernelPipe::Open(bool writing)
+{
+    lock->Acquire();
+    if (writing)
+	writers++;
+    else
+	readers++;
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// KernelPipe::Close
+// 	Drop a reference to one end.  Closing the last write end wakes
+//	the readers so that they see end of file; closing the last read
+//	end wakes the writers so that they can give up.  Closing an end
+//	that has no references left is ignored.  Return TRUE if no ends
+//	are left, in which case the caller should delete the pipe.
+//----------------------------------------------------------------------
+
+bool
+KernelPipe::Close(bool writing)
+{
+    bool unused;
+
+    lock->Acquire();
+    if (writing) {
+	if (writers > 0 && --writers == 0)
+	    notEmpty->Broadcast(lock);
+    } else {
+	if (readers > 0 && --readers == 0)
+	    notFull->Broadcast(lock);
+    }
+    unused = (readers == 0 && writers == 0);
+    lock->Release();
+    return unused;
+}
+
+//----------------------------------------------------------------------
+// PipeTable::PipeTable
+// 	Initialize the pipe table to empty.
+//----------------------------------------------------------------------
+
+PipeTable::PipeTable()
+{
+    for (int i = 0; i < MaxPipes; i++)
+	pipes[i] = NULL;
+}
+
+PipeTable::~PipeTable()
+{
+    for (int i = 0; i < MaxPipes; i++)
+	if (pipes[i] != NULL)
+	    delete pipes[i];
+}
+
+//----------------------------------------------------------------------
+// PipeTable::Create
+// 	Make a new pipe, and return the ids of its two ends.  Return
+//	FALSE if the table is full.
+//----------------------------------------------------------------------
+
+bool
+PipeTable::Create(int *readId, int *writeId)
+{
+    for (int i = 0; i < MaxPipes; i++)
+	if (pipes[i] == NULL) {
+	    pipes[i] = new KernelPipe();
+	    *readId = PipeIdBase + 2 * i;
+	    *writeId = PipeIdBase + 2 * i + 1;
+	    DEBUG('f', "Created pipe %d\n", i);
+	    return TRUE;
+	}
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// PipeTable::Find
+// 	Return the pipe that "id" refers to, or NULL.
+//----------------------------------------------------------------------
+
+KernelPipe *
+PipeTable::Find(int id)
+{
+    if (!IsPipe(id))
+	return NULL;
+    return pipes[(id - PipeIdBase) / 2];
+}
+
+//----------------------------------------------------------------------
+// PipeTable::Read
+// PipeTable::Write
+// 	Transfer data through the pipe end "id".  Reading from a write
+//	end, or writing to a read end, is an error (-1).
+//----------------------------------------------------------------------
+
+int
+PipeTable::Read(int id, char *into, int numBytes)
+{
+    KernelPipe *pipe = Find(id);
+
+    if (pipe == NULL || (id - PipeIdBase) % 2 != 0)
+	return -1;
+    return pipe->Read(into, numBytes);
+}
+
+int
+PipeTable::Write(int id, char *from, int numBytes)
+{
+    KernelPipe *pipe = Find(id);
+
+    if (pipe == NULL || (id - PipeIdBase) % 2 != 1)
+	return -1;
+    return pipe->Write(from, numBytes);
+}
+
+//----------------------------------------------------------------------
+// PipeTable::Open
+// PipeTable::Close
+// 	Add or drop a reference to the pipe end "id".  The pipe is freed
+//	when its last end is closed.
+//----------------------------------------------------------------------
+
+void
+PipeTable::Open(int id)
+{
+    KernelPipe *pipe = Find(id);
+
+    if (pipe != NULL)
+	pipe->Open((id - PipeIdBase) % 2 == 1);
+}
+
+void
+PipeTable::Close(int id)
+{
+    KernelPipe *pipe = Find(id);
+
+    if (pipe != NULL && pipe->Close((id - PipeIdBase) % 2 == 1)) {
+	DEBUG('f', "Freeing pipe %d\n", (id - PipeIdBase) / 2);
+	delete pipe;
+	pipes[(id - PipeIdBase) / 2] = NULL;
+    }
+}
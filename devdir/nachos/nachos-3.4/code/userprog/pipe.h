@@ -0,0 +1,75 @@
+// pipe.h
+//	Data structures for in-memory pipes between user programs.
+//
+//	A pipe is a bounded ring buffer in kernel memory.  Readers block
+//	while it is empty and writers block while it is full; once every
+//	write end has been closed, a reader sees end of file (a read of
+//	zero bytes) as soon as the buffer drains.  No data goes near the
+//	disk.
+//
+//	Pipe ends are named by small OpenFileIds just above ConsoleOutput,
+//	so they can be told apart from the OpenFile pointers handed out by
+//	Open: read end of pipe i is PipeIdBase + 2*i, write end is one more.
+
+#ifndef PIPE_H
+#define PIPE_H
+
+#include "copyright.h"
+#include "synch.h"
+
+#define PipeSize	512		// bytes buffered in each pipe
+#define MaxPipes	16		// pipes in the system at once
+#define PipeIdBase	2		// first OpenFileId used for pipe ends
+
+// One pipe: a ring buffer and the count of open ends of each kind.
+// (Not named "Pipe", which is the system call in syscall.h.)
+
+class KernelPipe {
+  public:
+    KernelPipe();
+    ~KernelPipe();
+
+    int Read(char *into, int numBytes);	// Wait for data, or EOF; return
+					// the number of bytes read
+    int Write(char *from, int numBytes);// Wait for room; return the number
+					// of bytes written, -1 if nobody
+					// can ever read them
+
+    void Open(bool writing);		// One more reference to an end
+    bool Close(bool writing);		// Drop a reference; TRUE if the
+					// pipe has no ends left
+
+  private:
+    char buffer[PipeSize];		// the ring buffer
+    int head;				// next byte to read
+    int count;				// bytes in the buffer
+    int readers;			// open read ends
+    int writers;			// open write ends
+    Lock *lock;				// protects all of the above
+    Condition *notEmpty;		// signalled when data (or EOF) arrives
+    Condition *notFull;			// signalled when room is made
+};
+
+// The system-wide table of pipes, indexed by OpenFileId.
+
+class PipeTable {
+  public:
+    PipeTable();
+    ~PipeTable();
+
+    bool Create(int *readId, int *writeId);	// Make a new pipe
+    bool IsPipe(int id)				// Is "id" a pipe end?
+	{ return id >= PipeIdBase && id < PipeIdBase + 2 * MaxPipes; }
+
+    int Read(int id, char *into, int numBytes);
+    int Write(int id, char *from, int numBytes);
+    void Open(int id);				// Duplicate a pipe end
+    void Close(int id);				// Release a pipe end
+
+  private:
+    KernelPipe *Find(int id);		// NULL if "id" is not an open pipe
+
+    KernelPipe *pipes[MaxPipes];
+};
+
+#endif // PIPE_H
@@ -42,8 +42,8 @@ void fff(int which){
     delete executable1;
     space1->InitRegisters();
     space1->RestoreState();
-    myThreads[0]->myPrint();
-    myThreads[0]->space->Resume(0);
+    threadTable->Find(0)->myPrint();
+    threadTable->Find(0)->space->Resume(0);
     machine->Run();
 }
 
@@ -29,6 +29,24 @@
 #define SC_Close	8
 #define SC_Fork		9
 #define SC_Yield	10
+#define SC_AsyncRead	11
+#define SC_AsyncWrite	12
+#define SC_WaitAny	13
+#define SC_Poll		14
+#define SC_Pipe		15
+#define SC_Dup2		16
+#define SC_ShmCreate	17
+#define SC_ShmAttach	18
+#define SC_ShmDetach	19
+#define SC_SemCreate	20
+#define SC_SemWait	21
+#define SC_SemSignal	22
+#define SC_Spawn	23
+#define SC_ThreadCreate	24
+#define SC_ExitThread	25
+#define SC_ThreadJoin	26
+#define SC_FutexWait	27
+#define SC_FutexWake	28
 
 #ifndef IN_ASM
 
@@ -58,6 +76,14 @@ typedef int SpaceId;
  * address space identifier
  */
 SpaceId Exec(char *name);
+
+/* Like Exec, but pass the program arguments: "argv" is a null-terminated
+ * array of at most MaxSpawnArgs strings (or 0 for none), which the new
+ * program receives as main(argc, argv).  The address space is set up
+ * before Spawn returns.  Returns -1 if "name" can't be opened.
+ */
+#define MaxSpawnArgs	8
+SpaceId Spawn(char *name, char **argv);
  
 /* Only return once the the user program "id" has finished.  
  * Return the exit status.
@@ -105,9 +131,79 @@ void Write(char *buffer, int size, OpenFileId id);
  */
 int Read(char *buffer, int size, OpenFileId id);
 
-/* Close the file, we're done reading and writing to it. */
+/* Close the file, we're done reading and writing to it.  Closing an id
+ * that isn't open in this program (for instance, one closed already)
+ * does nothing.
+ */
 void Close(OpenFileId id);
 
+/* Create a pipe: a bounded buffer in kernel memory.  fds[0] is set to
+ * the read end and fds[1] to the write end.  Read blocks until data is
+ * available, and returns 0 (end of file) once every write end has been
+ * closed; Write blocks while the pipe is full.  Returns 0, or -1 if no
+ * more pipes can be created.
+ */
+int Pipe(OpenFileId *fds);
+
+/* Make "std" (ConsoleInput or ConsoleOutput) refer to the pipe end "id"
+ * for the calling program and any program it Execs from now on.
+ * Dup2(std, std) puts "std" back on the console.  Returns 0 or -1.
+ */
+int Dup2(OpenFileId id, OpenFileId std);
+
+
+/* Shared memory and semaphores, for user programs that want to exchange
+ * data without going through the file system.
+ */
+
+/* Return the id of the shared memory segment named "key", creating it
+ * with "size" bytes of zeroed memory if no program has yet.  Returns -1
+ * on failure.
+ */
+int ShmCreate(int key, int size);
+
+/* Map segment "id" into the caller's address space, and return the
+ * address it starts at (-1 on failure).  Every program that attaches
+ * the segment sees the same physical memory.
+ */
+char *ShmAttach(int id);
+
+/* Unmap the segment attached at "addr".  The program that created the
+ * segment holds it too, until it exits; the segment is freed when that
+ * and every attachment are gone.  Returns 0 or -1.
+ */
+int ShmDetach(char *addr);
+
+/* Create a semaphore with initial value "value"; return its id or -1. */
+int SemCreate(int value);
+
+/* P() and V() on semaphore "id".  Return 0, or -1 if there is no such
+ * semaphore.
+ */
+int SemWait(int id);
+int SemSignal(int id);
+
+
+/* Asynchronous file I/O.  AsyncRead and AsyncWrite start a transfer at
+ * the current position of the open file (advancing it, as Read and Write
+ * do) and return a request id right away, or -1 on failure.  The buffer
+ * must not be touched until the request has completed.
+ */
+int AsyncRead(char *buffer, int size, OpenFileId id);
+int AsyncWrite(char *buffer, int size, OpenFileId id);
+
+/* Return -1 if request "req" is still in progress, and -2 if the caller
+ * has no such request.  Otherwise the request is finished: return the
+ * number of bytes transferred.
+ */
+int Poll(int req);
+
+/* Wait until any outstanding request of the caller completes, store the
+ * number of bytes transferred in "*result", and return its id.  Returns
+ * -1 immediately if the caller has no requests outstanding.
+ */
+int WaitAny(int *result);
+
 
 
 /* User-level thread operations: Fork and Yield.  To allow multiple
@@ -124,6 +220,29 @@ void Fork(void (*func)());
  */
 void Yield();		
 
+/* Start a thread running "func(arg)" in the same address space.  If
+ * "stack" is 0, the kernel gives the thread a stack region of its own
+ * in the address space; otherwise "stack" is used as its initial stack
+ * pointer.  When "func" returns, the thread calls ExitThread with the
+ * return value.  Returns an id for ThreadJoin, or -1.
+ */
+int ThreadCreate(int (*func)(int), int arg, char *stack);
+
+/* Finish the calling thread, without tearing down the address space. */
+void ExitThread(int status);
+
+/* Wait for thread "id" of this program to finish; return its status. */
+int ThreadJoin(int id);
+
+/* Futexes: for building user-level locks that only trap into the kernel
+ * when they are contended.  FutexWait sleeps only if "*addr" still equals
+ * "val", and returns 0 when woken, -1 straight away otherwise.
+ * FutexWake wakes up to "count" threads sleeping on "addr" and returns
+ * how many it woke.
+ */
+int FutexWait(int *addr, int val);
+int FutexWake(int *addr, int count);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */